@@ -0,0 +1,176 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+
+#include "puzzle.h"
+#include "puzzle_solver.h"
+#include "puzzle_parser.h"
+
+using namespace std;
+
+/**
+ * Times the rule functions and board checks one by one
+ *
+ * Each runs on fixed snapshots of a board: as parsed, and settled by the
+ * rules alone. A rule is run once before timing, so the timed calls scan
+ * a board they no longer change, as most calls in the heuristic loop do.
+ */
+class rule_bench
+{
+private:
+    struct entry
+    {
+        const char *name;
+        function<size_t(puzzle_solver &, puzzle &)> run; // returns calls made
+    };
+    vector<entry> entries;
+    size_t sink = 0; // keeps results of checks alive
+
+public:
+    rule_bench()
+    {
+        auto rule = [&](const char *name, void (puzzle_solver::*f)(puzzle &))
+        {
+            entries.push_back({name, [f](puzzle_solver &s, puzzle &p)
+                               {
+                                   (s.*f)(p);
+                                   return size_t(1);
+                               }});
+        };
+        rule("ban_edge_around_one", &puzzle_solver::ban_edge_around_one);
+        rule("ban_edge_around_two", &puzzle_solver::ban_edge_around_two);
+        rule("ban_edge_around_three", &puzzle_solver::ban_edge_around_three);
+        rule("ban_edge_around_point", &puzzle_solver::ban_edge_around_point);
+        rule("ban_point", &puzzle_solver::ban_point);
+        rule("link_around_one", &puzzle_solver::link_around_one);
+        rule("link_around_two", &puzzle_solver::link_around_two);
+        rule("link_around_three", &puzzle_solver::link_around_three);
+        rule("link_around_point", &puzzle_solver::link_around_point);
+        rule("prelink_around_threes", &puzzle_solver::prelink_around_threes);
+        entries.push_back({"is_correct", [&](puzzle_solver &s, puzzle &p)
+                           {
+                               sink += s.is_correct(p);
+                               return size_t(1);
+                           }});
+        entries.push_back({"is_multiple_loops", [&](puzzle_solver &, puzzle &p)
+                           {
+                               sink += p.is_multiple_loops();
+                               return size_t(1);
+                           }});
+        entries.push_back({"is_even_line_out", [&](puzzle_solver &, puzzle &p)
+                           {
+                               sink += p.is_even_line_out();
+                               return size_t(1);
+                           }});
+        // One call per point
+        entries.push_back({"get_conn", [&](puzzle_solver &, puzzle &p)
+                           {
+                               for (size_t row = 0; row <= p.rows; row++)
+                                   for (size_t col = 0; col <= p.cols; col++)
+                                       sink += p.get_conn(row, col);
+                               return (p.rows + 1) * (p.cols + 1);
+                           }});
+        entries.push_back({"to_string", [&](puzzle_solver &, puzzle &p)
+                           {
+                               sink += p.to_string().size();
+                               return size_t(1);
+                           }});
+    }
+
+    // The board as the search first sees it, rules run to a fixpoint
+    static puzzle settle(const puzzle &clues)
+    {
+        puzzle_solver s;
+        s.set_puzzle(clues);
+        s.win = {0, 0, clues.rows, clues.cols};
+        puzzle p = clues;
+        s.ban_edge_around_zero(p);
+        s.prelink_around_threes(p);
+        s.heuristic(p, 0);
+        return p;
+    }
+
+    void run(const string &board, const char *snapshot, const puzzle &p, double min_time)
+    {
+        puzzle_solver s;
+        s.set_puzzle(p);
+        s.win = {0, 0, p.rows, p.cols};
+        const double cells = double(p.rows) * p.cols;
+        for (const auto &e : entries)
+        {
+            puzzle b = p;
+            e.run(s, b);
+            // Double the repetitions until they take long enough to time
+            size_t reps = 1, calls = 0;
+            double elapsed = 0;
+            while (true)
+            {
+                calls = 0;
+                const auto start = chrono::steady_clock::now();
+                for (size_t i = 0; i < reps; i++)
+                    calls += e.run(s, b);
+                elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                if (elapsed >= min_time)
+                    break;
+                reps *= 2;
+            }
+            const double ns = elapsed * 1e9;
+            cout << left << setw(26) << board << setw(10) << snapshot << setw(24) << e.name
+                 << right << fixed << setprecision(1)
+                 << setw(12) << ns / calls << setw(10) << ns / reps / cells << "\n";
+        }
+    }
+
+    size_t get_sink()
+    {
+        return sink;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    double min_time = 0.05;
+    vector<string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        const string arg = argv[i];
+        if (arg == "--min-time" && i + 1 < argc)
+        {
+            min_time = stod(argv[++i]);
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+    {
+        cerr << "Usage: puzzle-loop-bench [--min-time S] <puzzle file>...\n";
+        return -1;
+    }
+    rule_bench bench;
+    cout << left << setw(26) << "board" << setw(10) << "snapshot" << setw(24) << "function"
+         << right << setw(12) << "ns/call" << setw(10) << "ns/cell" << "\n";
+    for (const auto &file : files)
+    {
+        ifstream in(file);
+        const string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        puzzle_parser parser(text);
+        puzzle p;
+        if (!parser.next(p))
+        {
+            cerr << file << ": no puzzle\n";
+            return -1;
+        }
+        const string board = file.substr(file.find_last_of('/') + 1) +
+                             " " + to_string(p.cols) + "x" + to_string(p.rows);
+        bench.run(board, "clues", p, min_time);
+        bench.run(board, "settled", rule_bench::settle(p), min_time);
+    }
+    // Only here so the checks cannot be optimised away
+    return bench.get_sink() == size_t(-1);
+}
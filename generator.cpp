@@ -0,0 +1,143 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "puzzle_generator.h"
+
+using namespace std;
+
+// "20x30" or "20"
+static bool parse_size(const string &s, size_t &cols, size_t &rows)
+{
+    try
+    {
+        size_t used = 0;
+        cols = stoul(s, &used);
+        rows = cols;
+        if (used < s.size())
+        {
+            if (s[used] != 'x')
+                return false;
+            rows = stoul(s.substr(used + 1));
+        }
+    }
+    catch (const exception &)
+    {
+        return false;
+    }
+    return cols > 0 && rows > 0;
+}
+
+int main(int argc, char **argv)
+{
+    generator_options opt;
+    vector<string> sizes;
+    size_t count = 1;
+    size_t jobs = 1;
+    string out_dir = ".";
+    for (int i = 1; i < argc; i++)
+    {
+        const string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc)
+        {
+            count = stoul(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            opt.seed = stoull(argv[++i]);
+        }
+        else if (arg == "--fill" && i + 1 < argc)
+        {
+            opt.fill = stod(argv[++i]);
+        }
+        else if (arg == "--check-time" && i + 1 < argc)
+        {
+            opt.check_time = stod(argv[++i]);
+        }
+        else if (arg == "--check-nodes" && i + 1 < argc)
+        {
+            opt.check_nodes = stoul(argv[++i]);
+        }
+        else if (arg == "--max-checks" && i + 1 < argc)
+        {
+            opt.max_checks = stoul(argv[++i]);
+        }
+        else if (arg == "--jobs" && i + 1 < argc)
+        {
+            jobs = max<size_t>(1, stoul(argv[++i]));
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            out_dir = argv[++i];
+        }
+        else
+        {
+            sizes.push_back(arg);
+        }
+    }
+    if (sizes.empty())
+    {
+        cerr << "Usage: puzzle-loop-generator [options] <size>...\n";
+        return -1;
+    }
+    const uint64_t seed = opt.seed;
+    for (const auto &size : sizes)
+    {
+        if (!parse_size(size, opt.cols, opt.rows))
+        {
+            cerr << size << ": bad size\n";
+            return -1;
+        }
+        // One corpus file per size, one puzzle after another
+        const string name = out_dir + "/" + to_string(opt.cols) + "x" + to_string(opt.rows) + ".txt";
+        // Seeds are shared out to the jobs, output stays in seed order
+        struct result
+        {
+            puzzle p;
+            bool verified = false;
+            size_t clues = 0;
+        };
+        vector<result> results(count);
+        atomic<size_t> next_seed(0);
+        vector<thread> workers;
+        for (size_t j = 0; j < min(jobs, count); j++)
+        {
+            workers.emplace_back([&, opt]() mutable
+                                 {
+                                     for (size_t i; (i = next_seed++) < count;)
+                                     {
+                                         opt.seed = seed + i;
+                                         puzzle_generator gen(opt);
+                                         results[i].p = gen.generate(results[i].verified, results[i].clues);
+                                     } });
+        }
+        for (auto &w : workers)
+        {
+            w.join();
+        }
+        ofstream of(name);
+        for (size_t i = 0; i < count; i++)
+        {
+            const puzzle &p = results[i].p;
+            const bool verified = results[i].verified;
+            const size_t clues = results[i].clues;
+            of << p.cols << " " << p.rows << "\n";
+            for (const auto &row : p.lat)
+            {
+                for (const auto &c : row)
+                {
+                    of << (c >= 0 ? char('0' + c) : '-');
+                }
+                of << "\n";
+            }
+            of << "\nseed " << seed + i << ", clues " << clues
+               << (verified ? ", unique" : ", uniqueness not verified") << "\n\n";
+            cout << name << ": " << p.cols << "x" << p.rows << " seed " << seed + i
+                 << ", clues " << clues << (verified ? "" : " (not verified)") << endl;
+        }
+    }
+    return 0;
+}
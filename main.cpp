@@ -4,36 +4,339 @@
 #include <sstream>
 #include <vector>
 #include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <csignal>
 
 #include "puzzle.h"
 #include "puzzle_solver.h"
+#include "puzzle_parser.h"
+#include "puzzle_server.h"
+#include "puzzle_portfolio.h"
 
 using namespace std;
 
+namespace
+{
+    atomic<bool> checkpoint_now(false);
+    atomic<bool> interrupted(false);
+
+    // USR1 saves a checkpoint and goes on, TERM and INT save one and stop
+    void on_signal(int sig)
+    {
+        if (sig == SIGUSR1)
+            checkpoint_now = true;
+        else
+            interrupted = true;
+    }
+}
+
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    solver_options opt;
+    vector<string> files;
+    string serve;
+    string trace_file;
+    string resume_file;
+    size_t split = 0;
+    size_t portfolio = 0;
+    bool merge = false;
+    size_t workers = thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        const string arg = argv[i];
+        if (arg == "--probe-depth" && i + 1 < argc)
+        {
+            opt.probe_depth = stoul(argv[++i]);
+        }
+        else if (arg == "--probe-budget" && i + 1 < argc)
+        {
+            opt.probe_budget = stoul(argv[++i]);
+        }
+        else if (arg == "--time-limit" && i + 1 < argc)
+        {
+            opt.time_limit = stod(argv[++i]);
+        }
+        else if (arg == "--node-limit" && i + 1 < argc)
+        {
+            opt.node_limit = stoul(argv[++i]);
+        }
+        else if (arg == "--count-only")
+        {
+            opt.count_only = true;
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            trace_file = argv[++i];
+        }
+        else if (arg == "--progress" && i + 1 < argc)
+        {
+            opt.progress_interval = stod(argv[++i]);
+        }
+        else if (arg == "--tile" && i + 1 < argc)
+        {
+            opt.tile_size = stoul(argv[++i]);
+        }
+        else if (arg == "--max-solutions" && i + 1 < argc)
+        {
+            opt.max_solutions = stoul(argv[++i]);
+        }
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            serve = argv[++i];
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            workers = stoul(argv[++i]);
+        }
+        else if (arg == "--checkpoint" && i + 1 < argc)
+        {
+            opt.checkpoint_file = argv[++i];
+        }
+        else if (arg == "--checkpoint-interval" && i + 1 < argc)
+        {
+            opt.checkpoint_interval = stod(argv[++i]);
+        }
+        else if (arg == "--resume" && i + 1 < argc)
+        {
+            resume_file = argv[++i];
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            opt.seed = stoull(argv[++i]);
+        }
+        else if (arg == "--restarts" && i + 1 < argc)
+        {
+            opt.restart_nodes = stoul(argv[++i]);
+        }
+        else if (arg == "--split" && i + 1 < argc)
+        {
+            split = stoul(argv[++i]);
+        }
+        else if (arg == "--symmetry")
+        {
+            opt.symmetry = true;
+        }
+        else if (arg == "--portfolio" && i + 1 < argc)
+        {
+            portfolio = stoul(argv[++i]);
+        }
+        else if (arg == "--merge")
+        {
+            merge = true;
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (!serve.empty())
+    {
+        // A client that leaves early must not take the server down with it
+        signal(SIGPIPE, SIG_IGN);
+        puzzle_server server(workers);
+        if (serve == "-")
+        {
+            server.serve_fd(0, 1);
+            return 0;
+        }
+        server.serve_socket(serve);
+        cerr << serve << ": cannot listen or accept\n";
+        return -1;
+    }
+    if (files.empty())
     {
         cerr << "No puzzle file\n";
         return -1;
     }
+    // Solution files of split pieces into one, every solution once
+    if (merge)
+    {
+        unordered_set<string> seen;
+        ofstream of(files[0]);
+        for (size_t i = 1; i < files.size(); i++)
+        {
+            ifstream in(files[i]);
+            if (!in)
+            {
+                cerr << files[i] << ": cannot open\n";
+                return -1;
+            }
+            string line, board;
+            while (true)
+            {
+                const bool more = static_cast<bool>(getline(in, line));
+                if (more && !line.empty())
+                {
+                    board += line + "\n";
+                    continue;
+                }
+                if (!board.empty() && seen.insert(board).second)
+                    of << board << "\n";
+                board.clear();
+                if (!more)
+                    break;
+            }
+        }
+        cout << "Solutions: " << seen.size() << endl;
+        return 0;
+    }
     string output_file_name = "solution.txt";
-    if (argc == 3)
+    if (files.size() == 2)
     {
-        output_file_name = argv[2];
+        output_file_name = files[1];
     }
-    ifstream puzzle_file(argv[1]);
-    ofstream of(output_file_name);
-
-    puzzle_solver ps;
-    ps.read_puzzle(puzzle_file);
-    ps.set_output(of);
-    int n = ps.solve();
-    if (n <= 0)
+    // Check every puzzle before spending solver time on any
+    mapped_file file;
+    if (!file.open(files[0]))
     {
-        cerr << "Invalid puzzle\n";
+        cerr << files[0] << ": cannot open\n";
         return -1;
     }
-    cout << "Solutions: " << n << endl;
-    return 0;
+    vector<puzzle> puzzles;
+    puzzle_parser parser(file.view());
+    puzzle p;
+    while (parser.next(p))
+    {
+        puzzles.push_back(p);
+    }
+    if (!parser.get_error().empty())
+    {
+        cerr << files[0] << ":" << parser.get_error() << "\n";
+        return -1;
+    }
+    if (puzzles.empty())
+    {
+        cerr << files[0] << ": no puzzle\n";
+        return -1;
+    }
+    // A checkpoint holds the search of one puzzle
+    if ((!opt.checkpoint_file.empty() || !resume_file.empty() || split > 0) && puzzles.size() > 1)
+    {
+        cerr << files[0] << ": checkpoints need a file with one puzzle\n";
+        return -1;
+    }
+    if (portfolio > 0 && (!opt.checkpoint_file.empty() || !resume_file.empty() || split > 0))
+    {
+        cerr << "--portfolio runs without checkpoints\n";
+        return -1;
+    }
+    if (!opt.checkpoint_file.empty())
+    {
+        opt.checkpoint_now = &checkpoint_now;
+        opt.cancel = &interrupted;
+        signal(SIGUSR1, on_signal);
+        signal(SIGTERM, on_signal);
+        signal(SIGINT, on_signal);
+    }
+    // Nothing is written when only counting, a resumed search adds to
+    // the solutions written before
+    ofstream of;
+    if (!opt.count_only)
+        of.open(output_file_name, resume_file.empty() ? ios::out : ios::app);
+    solver_trace trace;
+    if (!trace_file.empty())
+        opt.trace = &trace;
+
+    int ret = 0;
+    for (size_t i = 0; i < puzzles.size(); i++)
+    {
+        if (puzzles.size() > 1)
+        {
+            cout << "Puzzle " << i + 1 << "\n";
+            of << "Puzzle " << i + 1 << "\n";
+        }
+        puzzle_solver ps;
+        ps.set_puzzle(puzzles[i]);
+        if (!opt.count_only)
+        {
+            ps.add_output(cout);
+            ps.add_output(of);
+        }
+        ps.set_options(opt);
+        if (!resume_file.empty())
+        {
+            ifstream rf(resume_file, ios::binary);
+            if (!ps.resume(rf))
+            {
+                cerr << resume_file << ": not a checkpoint of this puzzle\n";
+                return -1;
+            }
+        }
+        if (split > 0)
+        {
+            // Piece k goes to <puzzle file>.k, solve it with --resume
+            const auto pieces = ps.split(split);
+            for (size_t k = 0; k < pieces.size(); k++)
+            {
+                ofstream pf(files[0] + "." + to_string(k + 1), ios::binary);
+                pf << pieces[k];
+            }
+            if (ps.get_status() == puzzle_solver::INVALID && pieces.empty())
+            {
+                cerr << "Invalid puzzle\n";
+                return -1;
+            }
+            cout << "Pieces: " << pieces.size() << endl;
+            cout << "Solutions: " << ps.get_solution_count() << endl;
+            continue;
+        }
+        int n;
+        puzzle_solver::solve_status status;
+        puzzle partial;
+        if (portfolio > 0)
+        {
+            // Solutions are only known once a config has won
+            auto r = portfolio_solve(puzzles[i], portfolio_configs(opt, portfolio));
+            for (auto &s : r.solutions)
+            {
+                const auto text = s.to_string();
+                cout << text;
+                of << text;
+            }
+            if (r.status != puzzle_solver::LIMIT)
+                cerr << "Portfolio winner: config " << r.winner + 1 << "\n";
+            n = r.count;
+            status = r.status;
+            partial = r.partial;
+        }
+        else
+        {
+            n = ps.solve();
+            status = ps.get_status();
+            if (status == puzzle_solver::LIMIT)
+                partial = ps.get_partial();
+        }
+        if (status == puzzle_solver::LIMIT)
+        {
+            // Show how far deduction got, unless the search goes on later
+            if (!opt.checkpoint_file.empty())
+            {
+                cerr << "Checkpoint saved to " << opt.checkpoint_file << "\n";
+            }
+            else if (!opt.count_only)
+            {
+                const auto text = partial.to_string();
+                cout << text;
+                of << text;
+            }
+            cerr << "Limit reached\n";
+            cout << "Solutions so far: " << max(n, 0) << endl;
+            ret = ret < 0 ? ret : 2;
+            continue;
+        }
+        if (n <= 0)
+        {
+            cerr << "Invalid puzzle\n";
+            ret = -1;
+            continue;
+        }
+        cout << "Solutions: " << n << endl;
+    }
+    if (!trace_file.empty())
+    {
+        ofstream tf(trace_file);
+        trace.write(tf);
+    }
+    return ret;
 }
@@ -6,14 +6,16 @@
 #include <iostream>
 #include <set>
 #include <queue>
+#include <algorithm>
+#include <cstdint>
 
 using namespace std;
 
 class puzzle
 {
 public:
-    size_t cols, rows = 0;   // of lattice
-    vector<vector<int>> lat; // lattice
+    size_t cols = 0, rows = 0; // of lattice
+    vector<vector<int>> lat;   // lattice
 
     enum edge_state
     {
@@ -24,8 +26,106 @@ public:
     vector<vector<edge_state>> hrz; // horizon link
     vector<vector<edge_state>> vrt; // vertical link
 
+    struct edge
+    {
+        bool horizontal;
+        int row, col;
+    };
+
+    edge_state &at(const edge &e)
+    {
+        return e.horizontal ? hrz[e.row][e.col] : vrt[e.row][e.col];
+    }
+
+    edge_state at(const edge &e) const
+    {
+        return e.horizontal ? hrz[e.row][e.col] : vrt[e.row][e.col];
+    }
+
     vector<vector<bool>> banned_point;
 
+    // Empty board: no clues, every edge undecided
+    void init(const size_t &cols, const size_t &rows)
+    {
+        this->cols = cols;
+        this->rows = rows;
+        lat.assign(rows, vector<int>(cols, -1));
+        hrz.assign(rows + 1, vector<edge_state>(cols, NOT));
+        vrt.assign(rows, vector<edge_state>(cols + 1, NOT));
+        banned_point.assign(rows + 1, vector<bool>(cols + 1, false));
+    }
+
+    // Cells [top, bottom) x [left, right) as a board of their own
+    puzzle crop(size_t top, size_t left, size_t bottom, size_t right) const
+    {
+        puzzle c;
+        c.init(right - left, bottom - top);
+        for (size_t row = top; row <= bottom; row++)
+        {
+            for (size_t col = left; col <= right; col++)
+            {
+                if (row < bottom && col < right)
+                    c.lat[row - top][col - left] = lat[row][col];
+                if (col < right)
+                    c.hrz[row - top][col - left] = hrz[row][col];
+                if (row < bottom)
+                    c.vrt[row - top][col - left] = vrt[row][col];
+                c.banned_point[row - top][col - left] = banned_point[row][col];
+            }
+        }
+        return c;
+    }
+
+    size_t edge_count()
+    {
+        return (rows + 1) * cols + rows * (cols + 1);
+    }
+
+    size_t decided_count() const
+    {
+        size_t decided = 0;
+        for (const auto &row : hrz)
+            decided += count_if(row.begin(), row.end(), [](edge_state e)
+                                { return e != NOT; });
+        for (const auto &row : vrt)
+            decided += count_if(row.begin(), row.end(), [](edge_state e)
+                                { return e != NOT; });
+        return decided;
+    }
+
+    // One bit per edge, set when LINKED: horizontal edges row by row,
+    // then vertical edges row by row, low bit first
+    void pack(uint8_t *out)
+    {
+        fill(out, out + (edge_count() + 7) / 8, 0);
+        size_t bit = 0;
+        for (const auto &row : hrz)
+        {
+            for (const auto &e : row)
+            {
+                if (e == LINKED)
+                    out[bit / 8] |= 1 << (bit % 8);
+                bit++;
+            }
+        }
+        for (const auto &row : vrt)
+        {
+            for (const auto &e : row)
+            {
+                if (e == LINKED)
+                    out[bit / 8] |= 1 << (bit % 8);
+                bit++;
+            }
+        }
+    }
+
+    string packed()
+    {
+        string key((edge_count() + 7) / 8, '\0');
+        pack(reinterpret_cast<uint8_t *>(&key[0]));
+        return key;
+    }
+
     size_t get_conn(const int &p_r, const int &p_c)
     {
         size_t conn = 0;
@@ -185,72 +285,134 @@ public:
             return true;
     }
 
-    bool is_fin()
+    // What one pass over the board found
+    struct board_check
     {
-        for (size_t row = 0; row < rows; row++)
+        bool clue_over = false; // a clue has more lines or more bans than it allows
+        bool clues_met = true;  // every clue has exactly its lines
+        bool branch = false;    // a point with three or four lines
+        size_t ends = 0;        // points with one line
+        size_t loops = 0;       // closed pieces of line
+        size_t lines = 0;       // open pieces of line
+        bool odd_island = false; // open points around that hold an odd number of ends
+
+        bool many_loops() const
         {
-            for (size_t col = 0; col < cols; col++)
-            {
-                if (!complete_lat(row, col))
-                    return false;
-            }
+            return loops > 1 || (loops == 1 && lines > 0);
         }
-        for (size_t row = 0; row <= rows; row++)
+        bool correct() const // During solving
         {
-            for (size_t col = 0; col <= cols; col++)
-            {
-                if (get_conn(row, col) == 1 || get_conn(row, col) == 3)
-                {
-                    return false;
-                }
-            }
+            return !clue_over && !branch && !many_loops() && !odd_island;
         }
-        if (is_multiple_loops())
-            return false;
-        return true;
-    }
+        bool fin() const
+        {
+            return clues_met && ends == 0 && !branch && !many_loops();
+        }
+    };
 
-    bool is_correct() // During solving
+    /**
+     * Points are visited row by row, once each. A point's degree comes
+     * from its own four edges, and it is joined to its left and upper
+     * neighbours in two union-finds: pieces of line along linked edges,
+     * and islands of points with less than two lines along open edges.
+     * The cell below-right of the point is checked on the way.
+     */
+    board_check check()
     {
-        // check lattice
-        for (size_t row = 0; row < rows; row++)
+        board_check r;
+        const size_t w = cols + 1;
+        vector<int> line(w * (rows + 1)), island(w * (rows + 1));
+        vector<uint8_t> deg(w * (rows + 1));
+        auto find = [](vector<int> &uf, int x)
         {
-            for (size_t col = 0; col < cols; col++)
+            while (uf[x] != x)
             {
-                if (lat[row][col] >= 0)
-                {
-                    if (lat[row][col] < lat_edge(row, col))
-                        return false;
-                    if (4 - lat[row][col] < get_lat_banned_edge(row, col))
-                        return false;
-                }
+                uf[x] = uf[uf[x]];
+                x = uf[x];
             }
-        }
-        // check point
+            return x;
+        };
+        auto join = [&](vector<int> &uf, int a, int b)
+        {
+            uf[find(uf, a)] = find(uf, b);
+        };
         for (size_t row = 0; row <= rows; row++)
         {
             for (size_t col = 0; col <= cols; col++)
             {
-                if (get_conn(row, col) == 3)
+                const int v = row * w + col;
+                line[v] = island[v] = v;
+                // a neighbour that is banned as a whole takes no line
+                const bool up = row > 0 && !banned_point[row - 1][col];
+                const bool down = row < rows && !banned_point[row + 1][col];
+                const bool left = col > 0 && !banned_point[row][col - 1];
+                const bool right = col < cols && !banned_point[row][col + 1];
+                deg[v] = (up && vrt[row - 1][col] == LINKED) +
+                         (down && vrt[row][col] == LINKED) +
+                         (left && hrz[row][col - 1] == LINKED) +
+                         (right && hrz[row][col] == LINKED);
+                if (deg[v] >= 3)
+                    r.branch = true;
+                if (deg[v] == 1)
+                    r.ends++;
+                if (up && vrt[row - 1][col] == LINKED)
+                    join(line, v, v - w);
+                if (left && hrz[row][col - 1] == LINKED)
+                    join(line, v, v - 1);
+                const bool open = !banned_point[row][col];
+                if (deg[v] < 2 && up && open && vrt[row - 1][col] == NOT && deg[v - w] < 2)
+                    join(island, v, v - w);
+                if (deg[v] < 2 && left && open && hrz[row][col - 1] == NOT && deg[v - 1] < 2)
+                    join(island, v, v - 1);
+                if (row < rows && col < cols && lat[row][col] >= 0)
                 {
-                    return false;
+                    const int clue = lat[row][col];
+                    const int linked = (hrz[row][col] == LINKED) + (hrz[row + 1][col] == LINKED) +
+                                       (vrt[row][col] == LINKED) + (vrt[row][col + 1] == LINKED);
+                    const int banned = (hrz[row][col] == BAN) + (hrz[row + 1][col] == BAN) +
+                                       (vrt[row][col] == BAN) + (vrt[row][col + 1] == BAN);
+                    if (linked > clue || banned > 4 - clue)
+                        r.clue_over = true;
+                    if (linked != clue)
+                        r.clues_met = false;
                 }
-                // if (get_conn(row, col) == 1)
-                // {
-                //     size_t ban_edges = (point_can_up(row, col) ? 0 : 1) +
-                //                        (point_can_left(row, col) ? 0 : 1) +
-                //                        (point_can_down(row, col) ? 0 : 1) +
-                //                        (point_can_right(row, col) ? 0 : 1);
-                //     if (ban_edges >= 3)
-                //         return false;
-                // }
             }
         }
-        if (is_multiple_loops())
-            return false;
-        if (!is_even_line_out())
-            return false;
-        return true;
+        // Tally pieces and islands by their roots
+        vector<uint8_t> open_piece(line.size(), 0), seen(line.size(), 0);
+        vector<size_t> island_ends(island.size(), 0);
+        for (size_t v = 0; v < line.size(); v++)
+        {
+            if (deg[v] == 0)
+                continue;
+            const int root = find(line, v);
+            seen[root] = 1;
+            if (deg[v] == 1)
+                open_piece[root] = 1;
+        }
+        for (size_t v = 0; v < line.size(); v++)
+        {
+            if (seen[v])
+                (open_piece[v] ? r.lines : r.loops)++;
+            if (deg[v] == 1)
+                island_ends[find(island, v)]++;
+        }
+        for (const auto n : island_ends)
+        {
+            if (n % 2)
+                r.odd_island = true;
+        }
+        return r;
+    }
+
+    bool is_fin()
+    {
+        return check().fin();
+    }
+
+    bool is_correct() // During solving
+    {
+        return check().correct();
     }
 
     bool is_multiple_loops()
@@ -0,0 +1,148 @@
+#include "puzzle_generator.h"
+#include "puzzle_loop.h"
+
+bool puzzle_generator::is_inside(int row, int col)
+{
+    if (row < 0 || col < 0 || row >= (int)opt.rows || col >= (int)opt.cols)
+        return false; // the border counts as outside
+    return inside[row][col];
+}
+
+bool puzzle_generator::can_add(int row, int col)
+{
+    /**
+     * 0 1 2
+     * 7 c 3
+     * 6 5 4
+     * Adding c keeps one loop when the ring around it has exactly one
+     * inside run, and no 2x2 block becomes a checkerboard (a vertex the
+     * loop would touch twice).
+     */
+    const int dr[8] = {-1, -1, -1, 0, 1, 1, 1, 0};
+    const int dc[8] = {-1, 0, 1, 1, 1, 0, -1, -1};
+    bool ring[8];
+    for (int i = 0; i < 8; i++)
+    {
+        ring[i] = is_inside(row + dr[i], col + dc[i]);
+    }
+    if (!ring[1] && !ring[3] && !ring[5] && !ring[7])
+        return false;
+    int runs = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        if (ring[i] && !ring[(i + 7) % 8])
+            runs++;
+    }
+    if (runs != 1)
+        return false;
+    // corners 0, 2, 4, 6 with their two edge neighbours
+    for (int i = 0; i < 8; i += 2)
+    {
+        const bool a = ring[(i + 7) % 8];
+        const bool b = ring[(i + 1) % 8];
+        if (ring[i] && !a && !b)
+            return false;
+        if (!ring[i] && a && b)
+            return false;
+    }
+    return true;
+}
+
+void puzzle_generator::grow_loop()
+{
+    inside.assign(opt.rows, vector<bool>(opt.cols, false));
+    uniform_int_distribution<size_t> pick_row(0, opt.rows - 1);
+    uniform_int_distribution<size_t> pick_col(0, opt.cols - 1);
+    inside[pick_row(rng)][pick_col(rng)] = true;
+    const size_t target = max<size_t>(1, opt.fill * opt.cols * opt.rows);
+    size_t size = 1;
+    // Random cells are offered until the region is big enough or stuck
+    for (size_t tries = 0; size < target && tries < 64 * opt.cols * opt.rows; tries++)
+    {
+        const int row = pick_row(rng);
+        const int col = pick_col(rng);
+        if (!inside[row][col] && can_add(row, col))
+        {
+            inside[row][col] = true;
+            size++;
+        }
+    }
+}
+
+void puzzle_generator::set_clues(puzzle &p)
+{
+    p.init(opt.cols, opt.rows);
+    for (size_t row = 0; row < opt.rows; row++)
+    {
+        for (size_t col = 0; col < opt.cols; col++)
+        {
+            const bool in = inside[row][col];
+            p.lat[row][col] = (is_inside(row - 1, col) != in) +
+                              (is_inside(row + 1, col) != in) +
+                              (is_inside(row, col - 1) != in) +
+                              (is_inside(row, col + 1) != in);
+        }
+    }
+}
+
+bool puzzle_generator::unique(const puzzle &p, size_t &checks)
+{
+    checks++;
+    solver_options so;
+    so.max_solutions = 2;
+    so.time_limit = opt.check_time;
+    so.node_limit = opt.check_nodes;
+    const loop_result r = loop_solve(p, so, nullptr, 0);
+    return r.status == puzzle_solver::DONE && r.solutions == 1;
+}
+
+puzzle puzzle_generator::generate(bool &verified, size_t &clues)
+{
+    puzzle p;
+    grow_loop();
+    set_clues(p);
+    size_t checks = 0;
+    verified = unique(p, checks);
+    clues = opt.cols * opt.rows;
+    if (!verified)
+        return p;
+    // Drop clues in random order, a batch at a time, while still unique
+    vector<pair<int, int>> order;
+    for (size_t row = 0; row < opt.rows; row++)
+    {
+        for (size_t col = 0; col < opt.cols; col++)
+        {
+            order.push_back({row, col});
+        }
+    }
+    shuffle(order.begin(), order.end(), rng);
+    const size_t widest = max<size_t>(1, order.size() / 64);
+    size_t batch = widest;
+    size_t next = 0;
+    while (next < order.size() && (opt.max_checks == 0 || checks < opt.max_checks))
+    {
+        const size_t end = min(next + batch, order.size());
+        vector<int> saved;
+        for (size_t i = next; i < end; i++)
+        {
+            saved.push_back(p.lat[order[i].first][order[i].second]);
+            p.lat[order[i].first][order[i].second] = -1;
+        }
+        if (unique(p, checks))
+        {
+            clues -= end - next;
+            next = end;
+            batch = min(batch * 2, widest);
+            continue;
+        }
+        for (size_t i = next; i < end; i++)
+        {
+            p.lat[order[i].first][order[i].second] = saved[i - next];
+        }
+        if (batch > 1)
+            batch /= 2; // retry the same cells in smaller pieces
+        else
+            next++;     // this clue is needed
+    }
+    return p;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "puzzle.h"
+#include "puzzle_solver.h"
+
+using namespace std;
+
+struct generator_options
+{
+    size_t cols = 10, rows = 10;
+    uint64_t seed = 1;
+    double fill = 0.5;        // share of cells inside the loop to aim for
+    double check_time = 1.0;  // seconds one uniqueness check may take
+    size_t check_nodes = 0;   // DFS nodes one check may take, 0: no limit
+    size_t max_checks = 0;    // uniqueness checks per puzzle, 0: no limit
+};
+
+class puzzle_generator
+{
+private:
+    generator_options opt;
+    mt19937_64 rng;
+    vector<vector<bool>> inside; // cells inside the loop
+
+public:
+    puzzle_generator(const generator_options &opt) : opt(opt), rng(opt.seed) {}
+
+    // A puzzle whose single solution is a random loop. verified is false
+    // when a check ran out of time before uniqueness of the full clue set
+    // was confirmed.
+    puzzle generate(bool &verified, size_t &clues);
+
+private:
+    void grow_loop();
+    bool can_add(int row, int col);
+    bool is_inside(int row, int col);
+    void set_clues(puzzle &p);
+    bool unique(const puzzle &p, size_t &checks);
+};
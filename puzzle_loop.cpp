@@ -0,0 +1,40 @@
+#include "puzzle_loop.h"
+#include "puzzle_parser.h"
+
+size_t loop_solution_bytes(size_t cols, size_t rows)
+{
+    return ((rows + 1) * cols + rows * (cols + 1) + 7) / 8;
+}
+
+loop_result loop_solve(string_view text, const solver_options &opt,
+                       uint8_t *out, size_t out_size)
+{
+    puzzle p;
+    puzzle_parser parser(text);
+    if (!parser.next(p))
+        return {puzzle_solver::BAD_INPUT, 0, 0, 0, 0};
+    return loop_solve(p, opt, out, out_size);
+}
+
+loop_result loop_solve(const puzzle &p, const solver_options &opt,
+                       uint8_t *out, size_t out_size)
+{
+    loop_result result = {puzzle_solver::BAD_INPUT, 0, 0, 0, 0};
+    puzzle_solver ps;
+    ps.set_puzzle(p);
+    result.cols = ps.get_cols();
+    result.rows = ps.get_rows();
+    const size_t bytes = loop_solution_bytes(result.cols, result.rows);
+    ps.set_options(opt);
+    ps.set_callback([&](puzzle &solution)
+                    {
+                        if ((result.written + 1) * bytes <= out_size)
+                        {
+                            solution.pack(out + result.written * bytes);
+                            result.written++;
+                        } });
+    const int n = ps.solve();
+    result.solutions = max(n, 0);
+    result.status = ps.get_status();
+    return result;
+}
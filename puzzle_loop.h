@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "puzzle_solver.h"
+
+using namespace std;
+
+struct loop_result
+{
+    puzzle_solver::solve_status status;
+    size_t cols, rows; // board size, 0 when the text did not parse
+    size_t solutions;  // found by the search
+    size_t written;    // packed into the caller's buffer
+};
+
+// Bytes taken by one packed solution, see puzzle::pack for the layout
+size_t loop_solution_bytes(size_t cols, size_t rows);
+
+// Solve the puzzle held in text. Solutions are packed into out one after
+// another while they fit in out_size bytes; the rest are only counted.
+// Nothing is shared between calls, so any thread may call it at any time.
+loop_result loop_solve(string_view text, const solver_options &opt,
+                       uint8_t *out, size_t out_size);
+// Same, for a board already parsed
+loop_result loop_solve(const puzzle &p, const solver_options &opt,
+                       uint8_t *out, size_t out_size);
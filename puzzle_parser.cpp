@@ -0,0 +1,157 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "puzzle_parser.h"
+
+string_view puzzle_parser::next_line()
+{
+    const size_t end = min(text.find('\n', pos), text.size());
+    string_view s = text.substr(pos, end - pos);
+    if (!s.empty() && s.back() == '\r')
+        s.remove_suffix(1);
+    pos = end < text.size() ? end + 1 : end;
+    line++;
+    return s;
+}
+
+bool puzzle_parser::fail(size_t col, const string &message)
+{
+    error = std::to_string(line - 1) + ":" + std::to_string(col + 1) + ": " + message;
+    pos = text.size();
+    return false;
+}
+
+bool puzzle_parser::parse_numbers(string_view s, size_t *numbers, size_t &count)
+{
+    count = 0;
+    size_t i = 0;
+    while (true)
+    {
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\t'))
+            i++;
+        if (i == s.size())
+            return count > 0;
+        if (!isdigit((unsigned char)s[i]))
+            return false;
+        size_t n = 0;
+        while (i < s.size() && isdigit((unsigned char)s[i]))
+        {
+            n = min(n * 10 + (s[i++] - '0'), max_size + 1);
+        }
+        // Only two are kept, the count tells a bad header apart
+        if (count < 2)
+            numbers[count] = n;
+        count++;
+    }
+}
+
+bool puzzle_parser::blank(string_view s)
+{
+    return s.find_first_not_of(" \t") == string_view::npos;
+}
+
+bool puzzle_parser::comment(string_view s)
+{
+    const size_t i = s.find_first_not_of(" \t");
+    return i != string_view::npos && s[i] == '#';
+}
+
+bool puzzle_parser::next(puzzle &p)
+{
+    error.clear();
+    // Header, skipping blank lines and comments
+    size_t numbers[2];
+    size_t count = 0;
+    bool found = false;
+    while (!found && pos < text.size())
+    {
+        const string_view s = next_line();
+        found = parse_numbers(s, numbers, count);
+        if (!found && !blank(s) && !comment(s) && !free_text)
+            return fail(0, "expected a '<cols> <rows>' header, comments start with '#'");
+    }
+    if (!found)
+        return false;
+    if (count > 2)
+        return fail(0, "header has " + std::to_string(count) + " numbers, expected '<cols> <rows>' or '<cols>'");
+    free_text = false;
+    if (count == 1)
+    {
+        size_t rows[2];
+        if (pos >= text.size() || !parse_numbers(next_line(), rows, count) || count != 1)
+            return fail(0, "expected the number of rows");
+        numbers[1] = rows[0];
+    }
+    const size_t cols = numbers[0];
+    const size_t rows = numbers[1];
+    if (cols == 0 || rows == 0 || cols > max_size || rows > max_size)
+        return fail(0, "board size must be 1 to " + std::to_string(max_size));
+    // Grid, written straight into the board
+    p.init(cols, rows);
+    for (size_t row = 0; row < rows; row++)
+    {
+        if (pos >= text.size())
+            return fail(0, "expected " + std::to_string(rows) + " rows, found " + std::to_string(row));
+        string_view s = next_line();
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        for (size_t col = 0; col < s.size(); col++)
+        {
+            const char c = s[col];
+            if (col >= cols)
+                return fail(col, "row has more than " + std::to_string(cols) + " cells");
+            if (c >= '0' && c <= '3')
+                p.lat[row][col] = c - '0';
+            else if (c != '-' && c != '.')
+                return fail(col, string("unexpected '") + c + "'");
+        }
+        if (s.size() < cols)
+            return fail(s.size(), "row has " + std::to_string(s.size()) + " cells, expected " + std::to_string(cols));
+    }
+    // The grid ends the text or is followed by a blank line, after which
+    // any text is a comment until the next header, or by a '#' comment
+    if (pos < text.size())
+    {
+        const string_view s = next_line();
+        if (blank(s))
+            free_text = true;
+        else if (!comment(s))
+            return fail(0, "surplus row, the header declares " + std::to_string(rows) + " rows");
+    }
+    return true;
+}
+
+mapped_file::~mapped_file()
+{
+    if (data != nullptr && size > 0)
+        munmap(const_cast<char *>(data), size);
+}
+
+bool mapped_file::open(const string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    size = st.st_size;
+    if (size > 0)
+    {
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED)
+        {
+            close(fd);
+            size = 0;
+            return false;
+        }
+        data = static_cast<const char *>(m);
+    }
+    close(fd);
+    return true;
+}
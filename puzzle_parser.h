@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "puzzle.h"
+
+using namespace std;
+
+/**
+ * Puzzle text
+ *
+ * <cols> <rows>        or  <cols>
+ * <row>                    <rows>
+ * ...                      <row>
+ *                          ...
+ *                      <blank line>
+ * <comments>
+ *
+ * Every row holds exactly cols cells: '0' to '3' for a clue, '-' or '.'
+ * for none. A text may hold many puzzles. Lines starting with '#' are
+ * comments anywhere between puzzles. Any other text is a comment only
+ * after a blank line that follows a grid, until the next header. A line
+ * of numbers alone is always a header.
+ */
+class puzzle_parser
+{
+private:
+    string_view text;
+    size_t pos = 0;
+    size_t line = 1; // of pos
+    bool free_text = false; // a blank line followed the last grid
+    string error;
+
+public:
+    static const size_t max_size = 4096;
+
+    puzzle_parser(string_view text) : text(text) {}
+
+    // Parse the next puzzle into p, false at the end of text or on error
+    bool next(puzzle &p);
+    // "line:col: message" for the last failure, empty at a clean end
+    const string &get_error()
+    {
+        return error;
+    }
+
+private:
+    string_view next_line();
+    bool fail(size_t col, const string &message);
+    // True for a line of numbers alone; keeps the first two, counts all
+    static bool parse_numbers(string_view s, size_t *numbers, size_t &count);
+    static bool blank(string_view s);
+    static bool comment(string_view s);
+};
+
+// Read-only view of a whole file, memory-mapped
+class mapped_file
+{
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file();
+
+    bool open(const string &path);
+    string_view view()
+    {
+        return string_view(data, size);
+    }
+};
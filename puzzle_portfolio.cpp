@@ -0,0 +1,128 @@
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "puzzle_portfolio.h"
+
+vector<solver_options> portfolio_configs(const solver_options &base, size_t n)
+{
+    vector<solver_options> configs;
+    // Setups in turn; restarts only run when one or two solutions are enough
+    vector<int> setups = {0, 1, 2, 3, 4};
+    if (base.max_solutions != 1 && base.max_solutions != 2)
+        setups.erase(setups.begin() + 3);
+    for (size_t i = 0; i < n; i++)
+    {
+        solver_options opt = base;
+        if (i > 0)
+            opt.progress_interval = 0;
+        opt.checkpoint_file.clear();
+        opt.checkpoint_interval = 0;
+        opt.checkpoint_now = nullptr;
+        switch (setups[i % setups.size()])
+        {
+        case 1:
+            opt.probe_depth = base.probe_depth + 1;
+            break;
+        case 2:
+            opt.probe_depth = 0;
+            break;
+        case 3:
+            opt.restart_nodes = 256;
+            break;
+        case 4:
+            opt.tile_size = 16;
+            break;
+        }
+        if (i >= setups.size())
+            opt.seed = base.seed + i;
+        configs.push_back(opt);
+    }
+    return configs;
+}
+
+portfolio_result portfolio_solve(const puzzle &p, const vector<solver_options> &configs)
+{
+    struct entry
+    {
+        puzzle_solver ps;
+        vector<puzzle> solutions;
+        int count = 0;
+        puzzle_solver::solve_status status = puzzle_solver::LIMIT;
+    };
+    vector<entry> entries(configs.size());
+    atomic<bool> stop(false);
+    const atomic<bool> *outer = configs.empty() ? nullptr : configs[0].cancel;
+    mutex lock; // guards running and winner
+    condition_variable finished;
+    size_t running = configs.size();
+    size_t winner = configs.size();
+
+    vector<thread> threads;
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        threads.emplace_back([&, i]()
+                             {
+                                 auto &e = entries[i];
+                                 solver_options opt = configs[i];
+                                 opt.cancel = &stop;
+                                 e.ps.set_puzzle(p);
+                                 e.ps.set_options(opt);
+                                 e.ps.set_callback([&e](puzzle &s)
+                                                   { e.solutions.push_back(s); });
+                                 e.count = e.ps.solve();
+                                 e.status = e.ps.get_status();
+                                 lock_guard<mutex> guard(lock);
+                                 running--;
+                                 if (winner == configs.size() && e.status != puzzle_solver::LIMIT)
+                                 {
+                                     winner = i;
+                                     stop = true;
+                                 }
+                                 finished.notify_all(); });
+    }
+    {
+        // The caller's flag is polled, the solvers only watch stop
+        unique_lock<mutex> guard(lock);
+        while (running > 0)
+        {
+            finished.wait_for(guard, chrono::milliseconds(10));
+            if (outer != nullptr && outer->load())
+                stop = true;
+        }
+    }
+    for (auto &t : threads)
+        t.join();
+
+    portfolio_result result;
+    result.status = puzzle_solver::LIMIT;
+    if (winner == configs.size())
+    {
+        // Nobody finished: the one that got furthest stands in
+        size_t most = 0;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].count > entries[most].count)
+                most = i;
+        }
+        if (entries.empty())
+            return result;
+        winner = most;
+        size_t decided = 0;
+        for (auto &e : entries)
+        {
+            puzzle partial = e.ps.get_partial();
+            if (partial.decided_count() >= decided)
+            {
+                decided = partial.decided_count();
+                result.partial = partial;
+            }
+        }
+    }
+    auto &e = entries[winner];
+    result.winner = winner;
+    result.status = e.status;
+    result.count = e.count;
+    result.solutions = move(e.solutions);
+    return result;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "puzzle.h"
+#include "puzzle_solver.h"
+
+using namespace std;
+
+struct portfolio_result
+{
+    puzzle_solver::solve_status status;
+    size_t winner = 0;        // config that finished first
+    int count = 0;            // its solve() result
+    vector<puzzle> solutions; // its solutions, none when counting only
+    puzzle partial;           // most deduced board when every config hit a limit
+};
+
+// n configs built from base: as given, deeper probes, rules only,
+// shuffled restarts (only with max_solutions 1 or 2) and tiles, then the
+// same again with other seeds.
+// Only the first keeps progress reports; none saves checkpoints.
+vector<solver_options> portfolio_configs(const solver_options &base, size_t n);
+
+// Runs one solver per config on its own thread. The first to finish,
+// with DONE or INVALID, wins and the others are cancelled. The cancel
+// flag of the first config stops them all.
+portfolio_result portfolio_solve(const puzzle &p, const vector<solver_options> &configs);
@@ -0,0 +1,315 @@
+#include <cerrno>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "puzzle_server.h"
+#include "puzzle_parser.h"
+
+namespace
+{
+    // Buffered reads of lines and exact byte counts from a descriptor
+    class fd_reader
+    {
+    private:
+        int fd;
+        string buffer;
+        size_t pos = 0;
+
+        bool fill()
+        {
+            char chunk[65536];
+            const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n <= 0)
+                return false;
+            buffer.erase(0, pos);
+            pos = 0;
+            buffer.append(chunk, n);
+            return true;
+        }
+
+    public:
+        fd_reader(int fd) : fd(fd) {}
+
+        bool read_line(string &line)
+        {
+            size_t end;
+            while ((end = buffer.find('\n', pos)) == string::npos)
+            {
+                if (!fill())
+                    return false;
+            }
+            line.assign(buffer, pos, end - pos);
+            pos = end + 1;
+            return true;
+        }
+
+        bool read_exact(size_t size, string &data)
+        {
+            while (buffer.size() - pos < size)
+            {
+                if (!fill())
+                    return false;
+            }
+            data.assign(buffer, pos, size);
+            pos += size;
+            return true;
+        }
+    };
+
+    bool write_all(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            // A socket whose peer left fails with EPIPE instead of raising SIGPIPE
+            ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == ENOTSOCK)
+                n = ::write(fd, data, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // Most solutions one RESULT carries, and most bytes of them
+    const size_t page_solutions = 64;
+    const size_t page_bytes = 64 << 20;
+
+    const char *status_name(puzzle_solver::solve_status status)
+    {
+        switch (status)
+        {
+        case puzzle_solver::DONE:
+            return "DONE";
+        case puzzle_solver::INVALID:
+            return "INVALID";
+        case puzzle_solver::LIMIT:
+            return "LIMIT";
+        default:
+            return "BAD_INPUT";
+        }
+    }
+}
+
+puzzle_server::puzzle_server(size_t workers)
+{
+    for (size_t i = 0; i < max<size_t>(workers, 1); i++)
+    {
+        this->workers.emplace_back(&puzzle_server::work, this);
+    }
+}
+
+puzzle_server::~puzzle_server()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void puzzle_server::work()
+{
+    // Kept across requests, so a warm worker rarely allocates
+    puzzle p;
+    vector<uint8_t> buffer;
+    while (true)
+    {
+        job j;
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this]
+                      { return quit || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            j = move(jobs.front());
+            jobs.pop_front();
+        }
+        run(j, p, buffer);
+    }
+}
+
+void puzzle_server::run(job &j, puzzle &p, vector<uint8_t> &buffer)
+{
+    const string id = j.id;
+    if (j.cancel->load())
+    {
+        finish(j, "RESULT " + id + " CANCELLED 0 0 0 0 0", nullptr, 0);
+        return;
+    }
+    solver_options opt;
+    opt.max_solutions = j.max_solutions;
+    opt.cancel = j.cancel.get();
+    if (j.has_deadline)
+    {
+        const chrono::duration<double> left = j.deadline - chrono::steady_clock::now();
+        if (left.count() <= 0)
+        {
+            finish(j, "RESULT " + id + " LIMIT 0 0 0 0 0", nullptr, 0);
+            return;
+        }
+        opt.time_limit = left.count();
+    }
+    puzzle_parser parser(j.text);
+    if (!parser.next(p))
+    {
+        finish(j, "RESULT " + id + " BAD_INPUT 0 0 0 0 0", nullptr, 0);
+        return;
+    }
+    // Room for a page of solutions at most, whatever the client asked
+    // for; the header still counts them all
+    const size_t bytes = loop_solution_bytes(p.cols, p.rows);
+    const size_t page = max<size_t>(min<size_t>(page_solutions, page_bytes / bytes), 1);
+    buffer.resize(bytes * (j.max_solutions > 0 ? min(j.max_solutions, page) : page));
+    const loop_result r = loop_solve(p, opt, buffer.data(), buffer.size());
+    const size_t size = r.written * bytes;
+    stringstream header;
+    header << "RESULT " << id << " "
+           << (j.cancel->load() ? "CANCELLED" : status_name(r.status)) << " "
+           << r.cols << " " << r.rows << " " << r.solutions << " "
+           << r.written << " " << size;
+    finish(j, header.str(), buffer.data(), size);
+}
+
+void puzzle_server::reply(connection &conn, const string &header, const uint8_t *data, size_t size)
+{
+    {
+        lock_guard<mutex> guard(conn.write_lock);
+        if (conn.dropped)
+            return;
+        const string line = header + "\n";
+        if (write_all(conn.out, line.data(), line.size()) &&
+            write_all(conn.out, reinterpret_cast<const char *>(data), size))
+            return;
+        conn.dropped = true;
+    }
+    // The client is gone: nobody waits for its other jobs, and the reader
+    // sees the end of its input
+    {
+        lock_guard<mutex> guard(conn.lock);
+        for (auto &r : conn.running)
+            r.second->store(true);
+    }
+    shutdown(conn.out, SHUT_RDWR);
+}
+
+void puzzle_server::finish(job &j, const string &header, const uint8_t *data, size_t size)
+{
+    reply(*j.conn, header, data, size);
+    lock_guard<mutex> guard(j.conn->lock);
+    auto it = j.conn->running.find(j.id);
+    if (it != j.conn->running.end() && it->second == j.cancel)
+        j.conn->running.erase(it);
+    j.conn->pending--;
+    j.conn->idle.notify_all();
+}
+
+void puzzle_server::serve_fd(int in, int out)
+{
+    auto conn = make_shared<connection>();
+    conn->out = out;
+    fd_reader reader(in);
+    string line;
+    while (reader.read_line(line))
+    {
+        stringstream ss(line);
+        string command, id;
+        ss >> command >> id;
+        if (command == "SOLVE")
+        {
+            size_t deadline_ms = 0, max_solutions = 0, size = 0;
+            ss >> deadline_ms >> max_solutions >> size;
+            job j;
+            if (!ss)
+            {
+                // Without the size the body cannot be skipped; its lines
+                // are read as frames and ignored
+                reply(*conn, "ERROR " + (id.empty() ? "-" : id) + " bad SOLVE header", nullptr, 0);
+                continue;
+            }
+            if (!reader.read_exact(size, j.text))
+                break;
+            j.conn = conn;
+            j.id = id;
+            j.has_deadline = deadline_ms > 0;
+            j.deadline = chrono::steady_clock::now() + chrono::milliseconds(deadline_ms);
+            j.max_solutions = max_solutions;
+            j.cancel = make_shared<atomic<bool>>(false);
+            {
+                lock_guard<mutex> guard(conn->lock);
+                conn->running[id] = j.cancel;
+                conn->pending++;
+            }
+            {
+                lock_guard<mutex> guard(lock);
+                jobs.push_back(move(j));
+            }
+            wake.notify_one();
+        }
+        else if (command == "CANCEL")
+        {
+            lock_guard<mutex> guard(conn->lock);
+            auto it = conn->running.find(id);
+            if (it != conn->running.end())
+                it->second->store(true);
+        }
+    }
+    // Input ended, answer what is still in flight
+    unique_lock<mutex> guard(conn->lock);
+    conn->idle.wait(guard, [&]
+                    { return conn->pending == 0; });
+}
+
+bool puzzle_server::serve_socket(const string &path)
+{
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        close(fd);
+        return false;
+    }
+    path.copy(addr.sun_path, path.size());
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        listen(fd, 64) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    while (true)
+    {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            // Out of descriptors or memory: wait for clients to leave
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                this_thread::sleep_for(chrono::milliseconds(100));
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+        thread([this, client]
+               {
+                   serve_fd(client, client);
+                   close(client); })
+            .detach();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "puzzle_loop.h"
+
+using namespace std;
+
+/**
+ * Framed protocol, the same over a Unix socket or stdin/stdout
+ *
+ * request  SOLVE <id> <deadline ms> <max solutions> <bytes>\n<puzzle text>
+ *          CANCEL <id>\n
+ * response RESULT <id> <status> <cols> <rows> <solutions> <packed> <bytes>\n<packed>
+ *          ERROR <id> <reason>\n
+ *
+ * A deadline or max solutions of 0 means none. <packed> solutions follow,
+ * loop_solution_bytes each, 64 at most (fewer on huge boards) however many
+ * were found. Status is DONE, INVALID, LIMIT, BAD_INPUT or
+ * CANCELLED. Results are sent as they finish, not in request order. A
+ * SOLVE line that does not parse gets an ERROR and the next line is read
+ * as a new frame. A client that cannot be written to any more is dropped
+ * and its jobs cancelled.
+ */
+class puzzle_server
+{
+private:
+    struct connection
+    {
+        int out;
+        mutex write_lock;     // guards writes to out and dropped
+        bool dropped = false; // a write failed, the client is gone
+        mutex lock; // guards running and pending
+        condition_variable idle;
+        unordered_map<string, shared_ptr<atomic<bool>>> running;
+        size_t pending = 0;
+    };
+    struct job
+    {
+        shared_ptr<connection> conn;
+        string id;
+        string text;
+        chrono::steady_clock::time_point deadline;
+        bool has_deadline;
+        size_t max_solutions;
+        shared_ptr<atomic<bool>> cancel;
+    };
+
+    vector<thread> workers;
+    mutex lock; // guards jobs and quit
+    condition_variable wake;
+    deque<job> jobs;
+    bool quit = false;
+
+public:
+    puzzle_server(size_t workers);
+    ~puzzle_server();
+
+    // Serve one stream pair until the input ends and every answer is sent
+    void serve_fd(int in, int out);
+    // Accept connections on a Unix socket, returns only if it cannot listen
+    // or accept
+    bool serve_socket(const string &path);
+
+private:
+    void work();
+    void run(job &j, puzzle &p, vector<uint8_t> &buffer);
+    void reply(connection &conn, const string &header, const uint8_t *data, size_t size);
+    void finish(job &j, const string &header, const uint8_t *data, size_t size);
+};
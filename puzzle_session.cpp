@@ -0,0 +1,121 @@
+#include "puzzle_session.h"
+
+puzzle_session::puzzle_session(const puzzle &p, const solver_options &opt) : opt(opt)
+{
+    solver.set_options(opt);
+    boards.push_back(p);
+    ok.push_back(solver.deduce(boards.back()));
+}
+
+bool puzzle_session::apply(const puzzle::edge &e, puzzle::edge_state state)
+{
+    if (state == puzzle::NOT)
+    {
+        retract(e);
+        return !contradiction();
+    }
+    // A second move on the same edge replaces the first
+    for (const auto &m : moves)
+    {
+        if (m.e.horizontal == e.horizontal && m.e.row == e.row && m.e.col == e.col)
+        {
+            retract(e);
+            break;
+        }
+    }
+    moves.push_back({e, state});
+    push(moves.back());
+    return !contradiction();
+}
+
+void puzzle_session::retract(const puzzle::edge &e)
+{
+    size_t k = moves.size();
+    while (k > 0)
+    {
+        const auto &m = moves[k - 1];
+        if (m.e.horizontal == e.horizontal && m.e.row == e.row && m.e.col == e.col)
+            break;
+        k--;
+    }
+    if (k == 0)
+        return;
+    // Back to the board before that move, then the later ones again
+    const vector<player_move> later(moves.begin() + k, moves.end());
+    moves.resize(k - 1);
+    boards.resize(k);
+    ok.resize(k);
+    solvable_cache = -1;
+    for (const auto &m : later)
+    {
+        moves.push_back(m);
+        push(m);
+    }
+}
+
+void puzzle_session::push(const player_move &m)
+{
+    solvable_cache = -1;
+    boards.push_back(boards.back());
+    ok.push_back(ok.back());
+    if (!ok.back())
+        return;
+    auto &b = boards.back();
+    const auto was = b.at(m.e);
+    if (was == m.state)
+        return;
+    if (was != puzzle::NOT)
+    {
+        ok.back() = false;
+        return;
+    }
+    b.at(m.e) = m.state;
+    ok.back() = solver.propagate(b, m.e);
+}
+
+vector<pair<puzzle::edge, puzzle::edge_state>> puzzle_session::forced()
+{
+    vector<pair<puzzle::edge, puzzle::edge_state>> edges;
+    puzzle played = boards.front();
+    for (const auto &m : moves)
+        played.at(m.e) = m.state;
+    const auto &b = boards.back();
+    auto check = [&](const puzzle::edge &e)
+    {
+        if (b.at(e) != puzzle::NOT && played.at(e) == puzzle::NOT)
+            edges.push_back({e, b.at(e)});
+    };
+    for (int row = 0; row <= int(b.rows); row++)
+    {
+        for (int col = 0; col <= int(b.cols); col++)
+        {
+            if (col < int(b.cols))
+                check({true, row, col});
+            if (row < int(b.rows))
+                check({false, row, col});
+        }
+    }
+    return edges;
+}
+
+puzzle_session::answer puzzle_session::solvable()
+{
+    if (contradiction())
+        return NO;
+    if (solvable_cache >= 0)
+        return answer(solvable_cache);
+    puzzle_solver s;
+    solver_options o = opt;
+    o.max_solutions = 1;
+    o.count_only = true;
+    // Unbounded options still get an answer in interactive time
+    if (o.time_limit == 0 && o.node_limit == 0)
+        o.time_limit = solvable_time;
+    s.set_puzzle(boards.back());
+    s.set_options(o);
+    const int n = s.solve();
+    if (s.get_status() == puzzle_solver::LIMIT)
+        return UNKNOWN;
+    solvable_cache = n > 0 ? YES : NO;
+    return answer(solvable_cache);
+}
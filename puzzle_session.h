@@ -0,0 +1,79 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "puzzle.h"
+#include "puzzle_solver.h"
+
+using namespace std;
+
+/**
+ * A board a player works on, move by move
+ *
+ *  boards[0]  clues, deduced once
+ *  boards[1]  + move 1, settled near it
+ *  boards[2]  + move 2, settled near it
+ *  ...
+ *
+ * Applying a move settles a copy of the last board around the edge.
+ * Taking the last move back just drops its board; an older one is taken
+ * out and the moves after it are applied again.
+ */
+class puzzle_session
+{
+public:
+    enum answer
+    {
+        NO,
+        YES,
+        UNKNOWN // the search ran out of time
+    };
+    // Budget of solvable() when the options set no time or node limit
+    static constexpr double solvable_time = 0.05;
+
+private:
+    struct player_move
+    {
+        puzzle::edge e;
+        puzzle::edge_state state;
+    };
+    puzzle_solver solver; // rules and probes, kept warm between moves
+    solver_options opt;
+    vector<player_move> moves;
+    vector<puzzle> boards;
+    vector<char> ok; // boards[k] holds no contradiction
+    int solvable_cache = -1;
+
+public:
+    puzzle_session(const puzzle &p, const solver_options &opt = solver_options());
+
+    // The player draws (LINKED) or crosses (BAN) one edge, NOT takes the
+    // move on it back. False when the board now holds a contradiction.
+    bool apply(const puzzle::edge &e, puzzle::edge_state state);
+    // Takes back the player's move on e, if there is one
+    void retract(const puzzle::edge &e);
+
+    bool contradiction()
+    {
+        return !ok.back();
+    }
+    // Edges the moves force, besides the moves and what the clues alone force
+    vector<pair<puzzle::edge, puzzle::edge_state>> forced();
+    // Searches for one solution within opt.time_limit and opt.node_limit,
+    // or solvable_time when neither is set; kept until the next move
+    answer solvable();
+
+    // The board with the moves and what they force
+    puzzle board()
+    {
+        return boards.back();
+    }
+    size_t move_count()
+    {
+        return moves.size();
+    }
+
+private:
+    void push(const player_move &m);
+};
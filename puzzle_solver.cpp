@@ -0,0 +1,2862 @@
+#include <iterator>
+#include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <array>
+
+#include "puzzle_solver.h"
+#include "puzzle_parser.h"
+
+namespace
+{
+    size_t state_bytes(const puzzle &p)
+    {
+        const size_t edges = (p.rows + 1) * p.cols + p.rows * (p.cols + 1);
+        const size_t points = (p.rows + 1) * (p.cols + 1);
+        return (2 * edges + points + 7) / 8;
+    }
+
+    // Edges two bits each (NOT 0, LINKED 1, BAN 2), horizontal then
+    // vertical, then banned points one bit each, low bit first
+    string pack_state(const puzzle &p)
+    {
+        string out(state_bytes(p), '\0');
+        size_t bit = 0;
+        auto put = [&](unsigned v, size_t bits)
+        {
+            for (size_t i = 0; i < bits; i++, bit++)
+                out[bit / 8] |= ((v >> i) & 1) << (bit % 8);
+        };
+        for (const auto &row : p.hrz)
+            for (const auto e : row)
+                put(e == puzzle::BAN ? 2 : e, 2);
+        for (const auto &row : p.vrt)
+            for (const auto e : row)
+                put(e == puzzle::BAN ? 2 : e, 2);
+        for (const auto &row : p.banned_point)
+            for (const bool b : row)
+                put(b, 1);
+        return out;
+    }
+
+    // Reads pack_state() into a board of the same size
+    bool unpack_state(istream &is, puzzle &p)
+    {
+        string in(state_bytes(p), '\0');
+        if (!is.read(&in[0], in.size()))
+            return false;
+        size_t bit = 0;
+        auto get = [&](size_t bits)
+        {
+            unsigned v = 0;
+            for (size_t i = 0; i < bits; i++, bit++)
+                v |= ((in[bit / 8] >> (bit % 8)) & 1) << i;
+            return v;
+        };
+        auto edge = [&](puzzle::edge_state &e)
+        {
+            const unsigned v = get(2);
+            e = v == 2 ? puzzle::BAN : puzzle::edge_state(v);
+            return v <= 2;
+        };
+        for (auto &row : p.hrz)
+            for (auto &e : row)
+                if (!edge(e))
+                    return false;
+        for (auto &row : p.vrt)
+            for (auto &e : row)
+                if (!edge(e))
+                    return false;
+        for (auto &row : p.banned_point)
+            for (size_t col = 0; col < row.size(); col++)
+                row[col] = get(1);
+        return true;
+    }
+
+    // The binary part after a text line starts past its newline
+    bool end_line(istream &is)
+    {
+        return is.get() == '\n';
+    }
+
+    // The 24 orders to try the ways up, down, left, right in, as is first
+    const vector<array<int, 4>> &way_orders()
+    {
+        static const vector<array<int, 4>> orders = []()
+        {
+            vector<array<int, 4>> all;
+            array<int, 4> order = {0, 1, 2, 3};
+            do
+                all.push_back(order);
+            while (next_permutation(order.begin(), order.end()));
+            return all;
+        }();
+        return orders;
+    }
+
+    // Restart budgets in units: 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ...
+    size_t luby(size_t i)
+    {
+        size_t k = 1;
+        while ((size_t(1) << k) - 1 < i)
+            k++;
+        if ((size_t(1) << k) - 1 == i)
+            return size_t(1) << (k - 1);
+        return luby(i - (size_t(1) << (k - 1)) + 1);
+    }
+}
+
+void puzzle_solver::read_puzzle(istream &is)
+{
+    const string text((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+    read_puzzle(string_view(text));
+}
+
+bool puzzle_solver::read_puzzle(string_view text)
+{
+    puzzle_parser parser(text);
+    return parser.next(p);
+}
+
+int puzzle_solver::solve()
+{
+    if (!begun && start() == false)
+    {
+        return -1;
+    }
+    // Restarts only pay off when a few solutions are enough; a full
+    // enumeration would search again what earlier runs partly covered
+    if (opt.restart_nodes > 0 && !opt.count_only && (opt.max_solutions == 1 || opt.max_solutions == 2))
+    {
+        restart();
+    }
+    else
+    {
+        while (step())
+        {
+        }
+    }
+    // A stopped search can be picked up again from here
+    if (stopped && !opt.checkpoint_file.empty())
+        write_checkpoint();
+    return solution_count;
+}
+
+bool puzzle_solver::next(puzzle &out)
+{
+    pulled = true;
+    if (!begun && start() == false)
+        return false;
+    while (pending.empty() && step())
+    {
+    }
+    if (pending.empty())
+        return false;
+    out = move(pending.front());
+    pending.pop_front();
+    return true;
+}
+
+void puzzle_solver::prepare()
+{
+    begun = true;
+    levels.assign(opt.probe_depth + 1, probe_level());
+    for (auto &level : levels)
+    {
+        level.budget = opt.probe_budget;
+    }
+    started = chrono::steady_clock::now();
+    last_report = started;
+    last_checkpoint = started;
+    current = &p;
+    win = {0, 0, p.rows, p.cols};
+    shuffle = opt.seed != 0 || opt.restart_nodes > 0;
+    yields = {};
+    find_symmetries();
+    rng.seed(opt.seed != 0 ? opt.seed : 1);
+}
+
+bool puzzle_solver::start()
+{
+    prepare();
+    ban_edge_around_zero(p);
+    prelink_around_threes(p);
+    best = p;
+    if (opt.tile_size > 0 && (p.rows > opt.tile_size || p.cols > opt.tile_size) &&
+        solve_tiles(p) == false)
+    {
+        return false;
+    }
+    if (heuristic(p, opt.probe_depth) == false)
+    {
+        return false;
+    }
+    if (opt.trace != nullptr)
+        opt.trace->counter("edges decided", "edges", p.decided_count());
+    keep_best(p);
+    // Heuristic done
+    begin_search();
+    return true;
+}
+
+void puzzle_solver::begin_search()
+{
+    const auto c = p.check();
+    if (c.fin() && c.correct())
+    {
+        report(p);
+    }
+    // Start with one line, any line end when shuffled
+    vector<pair<size_t, size_t>> ends;
+    for (size_t row = 0; row <= p.rows; row++)
+    {
+        for (size_t col = 0; col <= p.cols; col++)
+        {
+            if (!p.banned_point[row][col] && p.get_conn(row, col) == 1)
+                ends.push_back({row, col});
+        }
+        if (!ends.empty() && !shuffle)
+            break;
+    }
+    if (!ends.empty())
+    {
+        const auto end = ends[shuffle ? rng() % ends.size() : 0];
+        go_without_line(p, end.first, end.second, end.first, end.second);
+        return;
+    }
+    // Only closed loops drawn, nothing more can be added to them
+    for (size_t row = 0; row <= p.rows; row++)
+    {
+        for (size_t col = 0; col <= p.cols; col++)
+        {
+            if (p.get_conn(row, col) > 0)
+                return;
+        }
+    }
+    // No line on this map, try loops through every point in turn
+    root_scan = true;
+}
+
+void puzzle_solver::restart()
+{
+    for (size_t run = 1;; run++)
+    {
+        run_limit = nodes + opt.restart_nodes * luby(run);
+        // A way of the run's first frame that came back with nothing found
+        // is dead on the root board too, whatever the later runs try
+        const bool learn = frames.size() == 1 && !root_scan;
+        vector<puzzle::edge> dead;
+        bool trying = false;
+        size_t reached_before = 0;
+        puzzle::edge way{};
+        while (true)
+        {
+            if (learn && trying && frames.size() <= 1 && !stopped)
+            {
+                if (reached == reached_before)
+                    dead.push_back(way);
+                trying = false;
+            }
+            if (!step())
+                break;
+            if (learn && taken_at == 1)
+            {
+                trying = true;
+                way = taken;
+                reached_before = reached;
+            }
+            taken_at = 0;
+        }
+        if (!run_over)
+            break;
+        // Only the run's budget ran out, go again from the root
+        stopped = false;
+        run_over = false;
+        frames.clear();
+        root_scan = false;
+        size_t banned = 0;
+        for (const auto &e : dead)
+        {
+            if (p.at(e) == puzzle::NOT)
+            {
+                p.at(e) = puzzle::BAN;
+                banned++;
+            }
+        }
+        if (banned > 0)
+        {
+            if (heuristic(p, opt.probe_depth) == false)
+                break;
+            if (stopped)
+                break;
+            keep_best(p);
+        }
+        begin_search();
+    }
+    run_limit = 0;
+}
+
+void puzzle_solver::begin_deduction()
+{
+    if (levels.size() != opt.probe_depth + 1)
+    {
+        levels.assign(opt.probe_depth + 1, probe_level());
+        for (auto &level : levels)
+        {
+            level.budget = opt.probe_budget;
+        }
+    }
+    // Every call gets the whole time limit
+    started = chrono::steady_clock::now();
+    last_report = started;
+    stopped = false;
+    tile = false;
+}
+
+bool puzzle_solver::deduce(puzzle &board)
+{
+    begin_deduction();
+    win = {0, 0, board.rows, board.cols};
+    ban_edge_around_zero(board);
+    prelink_around_threes(board);
+    return heuristic(board, opt.probe_depth);
+}
+
+bool puzzle_solver::propagate(puzzle &board, const puzzle::edge &changed)
+{
+    begin_deduction();
+    // Rules look at most two cells away
+    const int margin = 2;
+    int top = changed.row - margin, left = changed.col - margin;
+    int bottom = changed.row + margin, right = changed.col + margin;
+    while (true)
+    {
+        win = {size_t(max(top, 0)), size_t(max(left, 0)),
+               size_t(min<int>(bottom, board.rows)), size_t(min<int>(right, board.cols))};
+        const puzzle before = board;
+        if (heuristic(board, opt.probe_depth) == false)
+            return false;
+        // Cells next to a changed edge, widened by the margin
+        int t = top, l = left, b = bottom, r = right;
+        for (size_t row = 0; row <= board.rows; row++)
+        {
+            for (size_t col = 0; col <= board.cols; col++)
+            {
+                const bool h = col < board.cols && board.hrz[row][col] != before.hrz[row][col];
+                const bool v = row < board.rows && board.vrt[row][col] != before.vrt[row][col];
+                if (!h && !v)
+                    continue;
+                t = min<int>(t, row - 1 - margin);
+                l = min<int>(l, col - 1 - margin);
+                b = max<int>(b, row + 1 + margin);
+                r = max<int>(r, col + 1 + margin);
+            }
+        }
+        if (t == top && l == left && b == bottom && r == right)
+            return true;
+        top = t;
+        left = l;
+        bottom = b;
+        right = r;
+    }
+}
+
+void puzzle_solver::report(puzzle &p)
+{
+    reached++;
+    if (symmetries.empty())
+    {
+        found(p);
+        return;
+    }
+    // Only the smallest solution of each orbit is searched for, the
+    // others are its images
+    if (!lex_leader(p, true))
+        return;
+    found(p);
+    unordered_set<string> images = {p.packed()};
+    for (const auto &g : symmetries)
+    {
+        if (enough)
+            return;
+        puzzle image = p;
+        for (size_t i = 0; i < edges.size(); i++)
+            image.at(edges[g.edge[i]]) = p.at(edges[i]);
+        for (size_t i = 0; i < g.point.size(); i++)
+            image.banned_point[g.point[i] / (p.cols + 1)][g.point[i] % (p.cols + 1)] =
+                p.banned_point[i / (p.cols + 1)][i % (p.cols + 1)];
+        if (images.insert(image.packed()).second)
+            found(image);
+    }
+}
+
+void puzzle_solver::find_symmetries()
+{
+    symmetries.clear();
+    edges.clear();
+    if (!opt.symmetry)
+        return;
+    const int rows = p.rows, cols = p.cols;
+    // Edges in packed order: horizontal row by row, then vertical
+    vector<vector<int>> hrz_index(rows + 1, vector<int>(cols)), vrt_index(rows, vector<int>(cols + 1));
+    for (int row = 0; row <= rows; row++)
+    {
+        for (int col = 0; col < cols; col++)
+        {
+            hrz_index[row][col] = edges.size();
+            edges.push_back({true, row, col});
+        }
+    }
+    for (int row = 0; row < rows; row++)
+    {
+        for (int col = 0; col <= cols; col++)
+        {
+            vrt_index[row][col] = edges.size();
+            edges.push_back({false, row, col});
+        }
+    }
+    /**
+     * Maps of the points: flip rows, flip columns and, on a square
+     * board, swap rows for columns. An edge goes where its two points go.
+     */
+    for (int m = 1; m < (rows == cols ? 8 : 4); m++)
+    {
+        auto map = [&](int row, int col, int &r, int &c)
+        {
+            if (m & 1)
+                row = rows - row;
+            if (m & 2)
+                col = cols - col;
+            r = m & 4 ? col : row;
+            c = m & 4 ? row : col;
+        };
+        bool same = true;
+        for (int row = 0; row < rows && same; row++)
+        {
+            for (int col = 0; col < cols && same; col++)
+            {
+                int r1, c1, r2, c2;
+                map(row, col, r1, c1);
+                map(row + 1, col + 1, r2, c2);
+                same = p.lat[row][col] == p.lat[min(r1, r2)][min(c1, c2)];
+            }
+        }
+        if (!same)
+            continue;
+        symmetry g;
+        for (const auto &e : edges)
+        {
+            int r1, c1, r2, c2;
+            map(e.row, e.col, r1, c1);
+            map(e.row + !e.horizontal, e.col + e.horizontal, r2, c2);
+            g.edge.push_back(r1 == r2 ? hrz_index[r1][min(c1, c2)] : vrt_index[min(r1, r2)][c1]);
+        }
+        for (int row = 0; row <= rows; row++)
+        {
+            for (int col = 0; col <= cols; col++)
+            {
+                int r, c;
+                map(row, col, r, c);
+                g.point.push_back(r * (cols + 1) + c);
+            }
+        }
+        symmetries.push_back(move(g));
+    }
+    if (symmetries.empty())
+        edges.clear();
+}
+
+bool puzzle_solver::lex_leader(puzzle &p, bool solved)
+{
+    // 1 linked, 0 not, -1 open; a solved board has no open edges
+    auto value = [&](size_t i)
+    {
+        const auto e = p.at(edges[i]);
+        return e == puzzle::LINKED ? 1 : e == puzzle::BAN || solved ? 0 : -1;
+    };
+    for (const auto &g : symmetries)
+    {
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            if (g.edge[i] == i)
+                continue;
+            const int a = value(i), b = value(g.edge[i]);
+            if (a < 0 || b < 0 || a < b)
+                break;
+            if (a > b)
+                return false; // the image is smaller, whatever comes next
+        }
+    }
+    return true;
+}
+
+void puzzle_solver::found(puzzle &p)
+{
+    // The search never reaches one solution twice, the set is a safety net
+    if (opt.count_only)
+    {
+        solution_count++;
+        if (pulled)
+            pending.push_back(p);
+        if (opt.max_solutions > 0 && solution_count >= opt.max_solutions)
+            enough = true;
+        return;
+    }
+    if (!puzzle_results.insert(p.packed()).second)
+        return;
+    solution_count++;
+    if (pulled)
+        pending.push_back(p);
+    if (on_solution)
+        on_solution(p);
+    if (!outputs.empty())
+    {
+        const auto result = p.to_string();
+        for (auto os : outputs)
+            *os << result;
+    }
+    if (opt.max_solutions > 0 && solution_count >= opt.max_solutions)
+        enough = true;
+}
+
+bool puzzle_solver::out_of_budget()
+{
+    if (stopped || enough)
+        return true;
+    if (opt.node_limit > 0 && nodes - resumed_nodes >= opt.node_limit)
+    {
+        stopped = true;
+    }
+    else if (run_limit > 0 && nodes >= run_limit)
+    {
+        stopped = true;
+        run_over = true;
+    }
+    else if (opt.cancel != nullptr && opt.cancel->load(memory_order_relaxed))
+    {
+        stopped = true;
+    }
+    else if ((opt.time_limit > 0 || opt.progress_interval > 0 || opt.checkpoint_interval > 0) &&
+             (++ticks & 0xf) == 0)
+    {
+        const auto now = chrono::steady_clock::now();
+        const chrono::duration<double> elapsed = now - started;
+        stopped = opt.time_limit > 0 && elapsed.count() >= opt.time_limit;
+        if (opt.checkpoint_interval > 0 &&
+            chrono::duration<double>(now - last_checkpoint).count() >= opt.checkpoint_interval)
+            checkpoint_due = true;
+        if (opt.progress_interval > 0 &&
+            chrono::duration<double>(now - last_report).count() >= opt.progress_interval)
+            progress(now);
+    }
+    return stopped;
+}
+
+void puzzle_solver::progress(chrono::steady_clock::time_point now)
+{
+    solver_progress r;
+    const double since = chrono::duration<double>(now - last_report).count();
+    r.elapsed = chrono::duration<double>(now - started).count();
+    r.nodes = nodes;
+    r.nodes_per_sec = (nodes - last_nodes) / since;
+    r.depth = depth;
+    if (current != nullptr)
+        r.decided = double(current->decided_count()) / current->edge_count();
+    r.probes = probes;
+    r.probes_per_sec = (probes - last_probes) / since;
+    r.solutions = solution_count;
+    last_report = now;
+    last_nodes = nodes;
+    last_probes = probes;
+    if (on_progress)
+    {
+        on_progress(r);
+        return;
+    }
+    ostringstream line;
+    line << fixed << setprecision(1) << "progress " << r.elapsed << "s"
+         << " nodes " << r.nodes << " (" << setprecision(0) << r.nodes_per_sec << "/s)"
+         << " depth " << r.depth
+         << " decided " << setprecision(1) << r.decided * 100 << "%"
+         << " probes " << r.probes << " (" << setprecision(0) << r.probes_per_sec << "/s)"
+         << " solutions " << r.solutions << "\n";
+    cerr << line.str();
+}
+
+void puzzle_solver::keep_best(puzzle &p)
+{
+    if (opt.time_limit <= 0 && opt.node_limit == 0 && opt.cancel == nullptr)
+        return;
+    const size_t decided = p.decided_count();
+    if (decided > best_decided)
+    {
+        best_decided = decided;
+        best = p;
+    }
+}
+
+bool puzzle_solver::heuristic(puzzle &p, size_t depth)
+{
+    // Sweeps run by probes are too many and too short to trace
+    trace_span span(depth > 0 ? opt.trace : nullptr, "heuristic", "heuristic");
+    // The board after the last step that changed it; copies reuse their rows
+    auto last_hrz = p.hrz;
+    auto last_vrt = p.vrt;
+    auto last_banned = p.banned_point;
+    auto changed = [&]()
+    {
+        if (p.hrz == last_hrz && p.vrt == last_vrt && p.banned_point == last_banned)
+            return false;
+        last_hrz = p.hrz;
+        last_vrt = p.vrt;
+        last_banned = p.banned_point;
+        return true;
+    };
+    while (true)
+    {
+        // Out of budget: stop quietly, no contradiction was proven
+        if (out_of_budget())
+            return true;
+        ban_edge_around_one(p);
+        ban_edge_around_two(p);
+        ban_edge_around_three(p);
+        ban_edge_around_point(p);
+        ban_point(p);
+        link_around_point(p);
+        link_around_three(p);
+        link_around_two(p);
+        link_around_one(p);
+        if (!is_correct(p))
+        {
+            return false;
+        }
+        // run out of normal methods
+        if (!changed())
+        {
+            // then the global ones, they only need to run on a settled board
+            size_t decided = 0;
+            if (!colour_cells(p, decided))
+                return false;
+            if (!tile && !ban_edge_off_block(p, decided))
+                return false;
+            if (decided == 0)
+                break;
+        }
+        // else normal method make sense
+    }
+    // look ahead
+    // go one level deeper only when the shallower levels run dry
+    // edges whose reach saw no change are not probed again
+    probe_memo memo;
+    size_t level = 1;
+    while (level <= depth && !out_of_budget())
+    {
+        if (try_draw(p, level, memo) == false)
+        {
+            return false;
+        }
+        if (!changed())
+        {
+            level++;
+        }
+        else
+        {
+            // look ahead make sense
+            // try cheap probes again
+            level = 1;
+        }
+    }
+    // look head not useful
+    // return to DFS
+    return true;
+}
+
+bool puzzle_solver::is_correct(puzzle &p)
+{
+    const auto c = p.check();
+    if (!tile)
+        return c.correct();
+    // Only what the tile can tell: a line leaving it may come back
+    // anywhere, so open line ends prove nothing here. Every cell of the
+    // tile board has its four edges, so its clues can all be checked.
+    return !c.clue_over && !c.branch && !c.many_loops();
+}
+
+bool puzzle_solver::solve_tiles(puzzle &p)
+{
+    /**
+     * +-------+---+-------+
+     * |       |   |       |
+     * |   a   |a b|   b   |
+     * |       |   |       |
+     * +-------+---+-------+
+     * Tiles overlap, so an edge near the side of one tile is well inside
+     * another. Each tile is cut out with one more cell on every side that
+     * is not the border, and its rules only scan the tile: whatever they
+     * read in that ring is the real board, so what they deduce holds for
+     * the whole board and tiles can be merged edge by edge.
+     */
+    trace_span span(opt.trace, "tiles", "tiles");
+    const size_t size = opt.tile_size;
+    const size_t step = max<size_t>(1, size - size / 4);
+    vector<window> tiles;
+    for (size_t top = 0;; top += step)
+    {
+        for (size_t left = 0;; left += step)
+        {
+            tiles.push_back({top, left, min(top + size, p.rows), min(left + size, p.cols)});
+            if (left + size >= p.cols)
+                break;
+        }
+        if (top + size >= p.rows)
+            break;
+    }
+    // Again while tiles learn from their neighbours
+    bool changed = true;
+    while (changed && !out_of_budget())
+    {
+        vector<puzzle> done(tiles.size());
+        vector<char> ok(tiles.size(), true);
+        atomic<size_t> next(0);
+        auto work = [&]()
+        {
+            for (size_t i; (i = next++) < tiles.size();)
+                ok[i] = solve_tile(p, tiles[i], done[i]);
+        };
+        vector<thread> workers;
+        const size_t jobs = min<size_t>(max(1u, thread::hardware_concurrency()), tiles.size());
+        for (size_t j = 1; j < jobs; j++)
+            workers.emplace_back(work);
+        work();
+        for (auto &w : workers)
+            w.join();
+        changed = false;
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            if (!ok[i])
+                return false;
+            const size_t top = tiles[i].top > 0 ? tiles[i].top - 1 : 0;
+            const size_t left = tiles[i].left > 0 ? tiles[i].left - 1 : 0;
+            const puzzle &t = done[i];
+            for (size_t row = 0; row <= t.rows; row++)
+            {
+                for (size_t col = 0; col <= t.cols; col++)
+                {
+                    for (const bool horizontal : {true, false})
+                    {
+                        if (horizontal ? col == t.cols : row == t.rows)
+                            continue;
+                        const auto s = horizontal ? t.hrz[row][col] : t.vrt[row][col];
+                        auto &e = p.at({horizontal, int(row + top), int(col + left)});
+                        if (s == puzzle::NOT || s == e)
+                            continue;
+                        if (e != puzzle::NOT)
+                            return false; // tiles disagree
+                        e = s;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool puzzle_solver::solve_tile(const puzzle &p, const window &w, puzzle &out)
+{
+    trace_span span(opt.trace, "tile", "tiles");
+    if (opt.trace != nullptr)
+        span.args = "\"top\":" + to_string(w.top) + ",\"left\":" + to_string(w.left);
+    const size_t top = w.top > 0 ? w.top - 1 : 0;
+    const size_t left = w.left > 0 ? w.left - 1 : 0;
+    const size_t bottom = min(w.bottom + 1, p.rows);
+    const size_t right = min(w.right + 1, p.cols);
+    puzzle_solver t;
+    t.opt = opt;
+    t.levels = levels;
+    t.started = started;
+    t.opt.progress_interval = 0; // the solver owning the board reports
+    t.tile = true;
+    t.win = {w.top - top, w.left - left, w.bottom - top, w.right - left};
+    out = p.crop(top, left, bottom, right);
+    const bool ok = t.heuristic(out, opt.probe_depth);
+    return ok || t.stopped;
+}
+
+void puzzle_solver::ban_edge_around_zero(puzzle &p)
+{
+    /**
+     * . b .
+     * b 0 b
+     * . b .
+     */
+    for (size_t row = 0; row < p.rows; row++)
+    {
+        for (size_t col = 0; col < p.cols; col++)
+        {
+            if (p.lat[row][col] == 0)
+            {
+                p.hrz[row][col] = puzzle::BAN;
+                p.hrz[row + 1][col] = puzzle::BAN;
+                p.vrt[row][col] = puzzle::BAN;
+                p.vrt[row][col + 1] = puzzle::BAN;
+            }
+        }
+    }
+}
+
+void puzzle_solver::prelink_around_threes(puzzle &p)
+{
+    /**
+     *   . l .
+     *     3
+     * b . l . b
+     *     3
+     *   . l .
+     */
+    for (size_t row = 0; row < p.rows - 1; row++)
+    {
+        for (size_t col = 0; col < p.cols; col++)
+        {
+            if (p.lat[row][col] == 3 && p.lat[row + 1][col] == 3)
+            {
+                p.hrz[row][col] = puzzle::LINKED;
+                p.hrz[row + 1][col] = puzzle::LINKED;
+                p.hrz[row + 2][col] = puzzle::LINKED;
+                if (p.point_can_left(row + 1, col))
+                    p.hrz[row + 1][col - 1] = puzzle::BAN;
+                if (p.point_can_right(row + 1, col + 1))
+                    p.hrz[row + 1][col + 1] = puzzle::BAN;
+            }
+        }
+    }
+    /**
+     *     b
+     * .   .   .
+     * l 3 l 3 l
+     * .   .   .
+     *     b
+     */
+    for (size_t row = 0; row < p.rows; row++)
+    {
+        for (size_t col = 0; col < p.cols - 1; col++)
+        {
+            if (p.lat[row][col] == 3 && p.lat[row][col + 1] == 3)
+            {
+                p.vrt[row][col] = puzzle::LINKED;
+                p.vrt[row][col + 1] = puzzle::LINKED;
+                p.vrt[row][col + 2] = puzzle::LINKED;
+                if (p.point_can_up(row, col + 1))
+                    p.vrt[row - 1][col + 1] = puzzle::BAN;
+                if (p.point_can_down(row + 1, col + 1))
+                    p.vrt[row + 1][col + 1] = puzzle::BAN;
+            }
+        }
+    }
+    /**
+     *   b
+     * b . l .   .
+     *   l 3
+     *   .   .   .
+     *         3 l
+     *   .   . l . b
+     *           b
+     */
+    for (size_t row = 0; row < p.rows - 1; row++)
+    {
+        for (size_t col = 0; col < p.cols - 1; col++)
+        {
+            if (p.lat[row][col] == 3 && p.lat[row + 1][col + 1] == 3)
+            {
+                p.hrz[row][col] = puzzle::LINKED;
+                p.vrt[row][col] = puzzle::LINKED;
+                p.hrz[row + 2][col + 1] = puzzle::LINKED;
+                p.vrt[row + 1][col + 2] = puzzle::LINKED;
+                if (p.point_can_up(row, col))
+                    p.vrt[row - 1][col] = puzzle::BAN;
+                if (p.point_can_left(row, col))
+                    p.hrz[row][col - 1] = puzzle::BAN;
+                if (p.point_can_down(row + 2, col + 2))
+                    p.vrt[row + 2][col + 2] = puzzle::BAN;
+                if (p.point_can_right(row + 2, col + 2))
+                    p.hrz[row + 2][col + 2] = puzzle::BAN;
+            }
+        }
+    }
+    /**
+     *           b
+     *   .   . l . b
+     *         3 l
+     *   .   .   .
+     *   l 3
+     * b . l .   .
+     *   b
+     */
+    for (size_t row = 0; row < p.rows - 1; row++)
+    {
+        for (size_t col = 0; col < p.cols - 1; col++)
+        {
+            if (p.lat[row][col + 1] == 3 && p.lat[row + 1][col] == 3)
+            {
+                p.hrz[row][col + 1] = puzzle::LINKED;
+                p.vrt[row][col + 2] = puzzle::LINKED;
+                p.hrz[row + 2][col] = puzzle::LINKED;
+                p.vrt[row + 1][col] = puzzle::LINKED;
+                if (p.point_can_up(row, col + 2))
+                    p.vrt[row - 1][col + 2] = puzzle::BAN;
+                if (p.point_can_right(row, col + 2))
+                    p.hrz[row][col + 2] = puzzle::BAN;
+                if (p.point_can_down(row + 2, col))
+                    p.vrt[row + 2][col] = puzzle::BAN;
+                if (p.point_can_left(row + 2, col))
+                    p.hrz[row + 2][col - 1] = puzzle::BAN;
+            }
+        }
+    }
+}
+
+void puzzle_solver::ban_edge_around_one(puzzle &p)
+{
+    /**
+     *   x
+     * x . b .
+     *   b 1
+     *   .   .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 1 && p.get_lat_banned_edge(row, col) < 2)
+            {
+                if (!p.point_can_up(row, col) &&
+                    !p.point_can_left(row, col))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+                if (!p.point_can_up(row, col + 1) &&
+                    !p.point_can_right(row, col + 1))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                if (!p.point_can_down(row + 1, col) &&
+                    !p.point_can_left(row + 1, col))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+                if (!p.point_can_down(row + 1, col + 1) &&
+                    !p.point_can_right(row + 1, col + 1))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+            }
+        }
+    }
+    /**
+     * . b .
+     * b 1 |
+     * . b .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 1 && p.get_lat_banned_edge(row, col) != 3)
+            {
+                if (p.hrz_has_edge(row, col))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.hrz_has_edge(row + 1, col))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.vrt_has_edge(row, col))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.vrt_has_edge(row, col + 1))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+            }
+        }
+    }
+    /**
+     *   x
+     * - .   .
+     *     1 b
+     *   . b .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 1 && p.get_lat_banned_edge(row, col) < 2)
+            {
+                if ((p.point_has_edge_up(row, col) || p.point_has_edge_left(row, col)) &&
+                    (!p.point_can_up(row, col) || !p.point_can_left(row, col)))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                if ((p.point_has_edge_up(row, col + 1) || p.point_has_edge_right(row, col + 1)) &&
+                    (!p.point_can_up(row, col + 1) || !p.point_can_right(row, col + 1)))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+                if ((p.point_has_edge_down(row + 1, col) || p.point_has_edge_left(row + 1, col)) &&
+                    (!p.point_can_down(row + 1, col) || !p.point_can_left(row + 1, col)))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                if ((p.point_has_edge_down(row + 1, col + 1) || p.point_has_edge_right(row + 1, col + 1)) &&
+                    (!p.point_can_down(row + 1, col + 1) || !p.point_can_right(row + 1, col + 1)))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+            }
+        }
+    }
+}
+
+void puzzle_solver::ban_edge_around_two(puzzle &p)
+{
+    /**
+     * . - .
+     * b 2 |
+     * . b .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 2 && p.get_lat_banned_edge(row, col) != 2)
+            {
+                if (p.hrz_has_edge(row, col) &&
+                    p.vrt_has_edge(row, col))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.hrz_has_edge(row, col) &&
+                         p.hrz_has_edge(row + 1, col))
+                {
+                    p.vrt[row][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.hrz_has_edge(row, col) &&
+                         p.vrt_has_edge(row, col + 1))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+                else if (p.hrz_has_edge(row + 1, col) &&
+                         p.vrt_has_edge(row, col))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.hrz_has_edge(row + 1, col) &&
+                         p.vrt_has_edge(row, col + 1))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+                else if (p.vrt_has_edge(row, col) &&
+                         p.vrt_has_edge(row, col + 1))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                }
+            }
+        }
+    }
+}
+
+void puzzle_solver::ban_edge_around_three(puzzle &p)
+{
+    /**
+     * . - .
+     * | 3 |
+     * . b .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 3 && p.get_lat_banned_edge(row, col) != 1)
+            {
+                if (p.hrz_has_edge(row, col) &&
+                    p.hrz_has_edge(row + 1, col) &&
+                    p.vrt_has_edge(row, col))
+                {
+                    p.vrt[row][col + 1] = puzzle::BAN;
+                }
+                else if (p.hrz_has_edge(row, col) &&
+                         p.hrz_has_edge(row + 1, col) &&
+                         p.vrt_has_edge(row, col + 1))
+                {
+                    p.vrt[row][col] = puzzle::BAN;
+                }
+                else if (p.vrt_has_edge(row, col) &&
+                         p.vrt_has_edge(row, col + 1) &&
+                         p.hrz_has_edge(row, col))
+                {
+                    p.hrz[row + 1][col] = puzzle::BAN;
+                }
+                else if (p.vrt_has_edge(row, col) &&
+                         p.vrt_has_edge(row, col + 1) &&
+                         p.hrz_has_edge(row + 1, col))
+                {
+                    p.hrz[row][col] = puzzle::BAN;
+                }
+            }
+        }
+    }
+}
+
+void puzzle_solver::ban_edge_around_point(puzzle &p)
+{
+    /**
+     *   x
+     * x . x
+     *   b
+     */
+    for (size_t row = win.top; row <= win.bottom; row++)
+    {
+        for (size_t col = win.left; col <= win.right; col++)
+        {
+            if (!p.point_can_up(row, col) &&
+                !p.point_can_down(row, col) &&
+                !p.point_can_left(row, col) &&
+                p.point_can_right(row, col))
+            {
+                p.hrz[row][col] = puzzle::BAN;
+            }
+            else if (!p.point_can_up(row, col) &&
+                     !p.point_can_down(row, col) &&
+                     p.point_can_left(row, col) &&
+                     !p.point_can_right(row, col))
+            {
+                p.hrz[row][col - 1] = puzzle::BAN;
+            }
+            else if (!p.point_can_up(row, col) &&
+                     p.point_can_down(row, col) &&
+                     !p.point_can_left(row, col) &&
+                     !p.point_can_right(row, col))
+            {
+                p.vrt[row][col] = puzzle::BAN;
+            }
+            else if (p.point_can_up(row, col) &&
+                     !p.point_can_down(row, col) &&
+                     !p.point_can_left(row, col) &&
+                     !p.point_can_right(row, col))
+            {
+                p.vrt[row - 1][col] = puzzle::BAN;
+            }
+        }
+    }
+    /**
+     *   b
+     * - . b
+     *   |
+     */
+    for (size_t row = win.top; row <= win.bottom; row++)
+    {
+        for (size_t col = win.left; col <= win.right; col++)
+        {
+            if (p.point_has_edge_up(row, col) &&
+                p.point_has_edge_down(row, col))
+            {
+                if (p.point_can_left(row, col))
+                    p.hrz[row][col - 1] = puzzle::BAN;
+                if (p.point_can_right(row, col))
+                    p.hrz[row][col] = puzzle::BAN;
+            }
+            else if (p.point_has_edge_left(row, col) &&
+                     p.point_has_edge_right(row, col))
+            {
+                if (p.point_can_up(row, col))
+                    p.vrt[row - 1][col] = puzzle::BAN;
+                if (p.point_can_down(row, col))
+                    p.vrt[row][col] = puzzle::BAN;
+            }
+            else if (p.point_has_edge_up(row, col) &&
+                     p.point_has_edge_left(row, col))
+            {
+                if (p.point_can_right(row, col))
+                    p.hrz[row][col] = puzzle::BAN;
+                if (p.point_can_down(row, col))
+                    p.vrt[row][col] = puzzle::BAN;
+            }
+            else if (p.point_has_edge_up(row, col) &&
+                     p.point_has_edge_right(row, col))
+            {
+                if (p.point_can_left(row, col))
+                    p.hrz[row][col - 1] = puzzle::BAN;
+                if (p.point_can_down(row, col))
+                    p.vrt[row][col] = puzzle::BAN;
+            }
+            else if (p.point_has_edge_down(row, col) &&
+                     p.point_has_edge_left(row, col))
+            {
+                if (p.point_can_up(row, col))
+                    p.vrt[row - 1][col] = puzzle::BAN;
+                if (p.point_can_right(row, col))
+                    p.hrz[row][col] = puzzle::BAN;
+            }
+            else if (p.point_has_edge_down(row, col) &&
+                     p.point_has_edge_right(row, col))
+            {
+                if (p.point_can_up(row, col))
+                    p.vrt[row - 1][col] = puzzle::BAN;
+                if (p.point_can_left(row, col))
+                    p.hrz[row][col - 1] = puzzle::BAN;
+            }
+        }
+    }
+}
+
+void puzzle_solver::ban_point(puzzle &p)
+{
+    /**
+     *   x
+     * x b x
+     *   x
+     */
+    for (size_t row = win.top; row <= win.bottom; row++)
+    {
+        for (size_t col = win.left; col <= win.right; col++)
+        {
+            if (!p.point_can_up(row, col) &&
+                !p.point_can_down(row, col) &&
+                !p.point_can_left(row, col) &&
+                !p.point_can_right(row, col))
+            {
+                p.banned_point[row][col] = true;
+            }
+        }
+    }
+}
+
+void puzzle_solver::link_around_one(puzzle &p)
+{
+    /**
+     * . x .
+     * x 1 x
+     * . l .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 1 &&
+                !p.complete_lat(row, col) &&
+                p.get_lat_banned_edge(row, col) == 3)
+            {
+                if (p.hrz[row][col] != puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                }
+                else if (p.hrz[row + 1][col] != puzzle::BAN)
+                {
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                }
+                else if (p.vrt[row][col] != puzzle::BAN)
+                {
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+                else if (p.vrt[row][col + 1] != puzzle::BAN)
+                {
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+            }
+        }
+    }
+}
+
+void puzzle_solver::link_around_two(puzzle &p)
+{
+    /**
+     * . l .
+     * x 2 x
+     * . l .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 2 &&
+                !p.complete_lat(row, col) &&
+                p.get_lat_banned_edge(row, col) == 2)
+            {
+                if (p.hrz[row][col] == puzzle::BAN &&
+                    p.hrz[row + 1][col] == puzzle::BAN)
+                {
+                    p.vrt[row][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                else if (p.vrt[row][col] == puzzle::BAN &&
+                         p.vrt[row][col + 1] == puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                }
+                else if (p.hrz[row][col] == puzzle::BAN &&
+                         p.vrt[row][col] == puzzle::BAN)
+                {
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                else if (p.hrz[row][col] == puzzle::BAN &&
+                         p.vrt[row][col + 1] == puzzle::BAN)
+                {
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+                else if (p.hrz[row + 1][col] == puzzle::BAN &&
+                         p.vrt[row][col] == puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                else if (p.hrz[row + 1][col] == puzzle::BAN &&
+                         p.vrt[row][col + 1] == puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+            }
+        }
+    }
+    /**
+     *       ?
+     *   .   . ?
+     *     2  
+     * ? .   . x
+     *   ?   x
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 2 &&
+                !p.complete_lat(row, col))
+            {
+                if (!p.point_can_up(row, col) && !p.point_can_left(row, col))
+                {
+                    if (!p.point_can_left(row + 1, col) && p.point_can_down(row + 1, col))
+                        p.vrt[row + 1][col] = puzzle::LINKED;
+                    if (p.point_can_left(row + 1, col) && !p.point_can_down(row + 1, col))
+                        p.hrz[row + 1][col - 1] = puzzle::LINKED;
+                    if (!p.point_can_right(row, col + 1) && p.point_can_up(row, col + 1))
+                        p.vrt[row - 1][col + 1] = puzzle::LINKED;
+                    if (p.point_can_right(row, col + 1) && !p.point_can_up(row, col + 1))
+                        p.hrz[row][col + 1] = puzzle::LINKED;
+                }
+                if (!p.point_can_up(row, col + 1) && !p.point_can_right(row, col + 1))
+                {
+                    if (!p.point_can_left(row, col) && p.point_can_up(row, col))
+                        p.vrt[row - 1][col] = puzzle::LINKED;
+                    if (p.point_can_left(row, col) && !p.point_can_up(row, col))
+                        p.hrz[row][col - 1] = puzzle::LINKED;
+                    if (!p.point_can_right(row + 1, col + 1) && p.point_can_down(row + 1, col + 1))
+                        p.vrt[row + 1][col + 1] = puzzle::LINKED;
+                    if (p.point_can_right(row + 1, col + 1) && !p.point_can_down(row + 1, col + 1))
+                        p.hrz[row + 1][col + 1] = puzzle::LINKED;
+                }
+                if (!p.point_can_down(row + 1, col + 1) && !p.point_can_right(row + 1, col + 1))
+                {
+                    if (!p.point_can_right(row, col + 1) && p.point_can_up(row, col + 1))
+                        p.vrt[row - 1][col + 1] = puzzle::LINKED;
+                    if (p.point_can_right(row, col + 1) && !p.point_can_up(row, col + 1))
+                        p.hrz[row][col + 1] = puzzle::LINKED;
+                    if (!p.point_can_left(row + 1, col) && p.point_can_down(row + 1, col))
+                        p.vrt[row + 1][col] = puzzle::LINKED;
+                    if (p.point_can_left(row + 1, col) && !p.point_can_down(row + 1, col))
+                        p.hrz[row + 1][col - 1] = puzzle::LINKED;
+                }
+                if (!p.point_can_down(row + 1, col) && !p.point_can_left(row + 1, col))
+                {
+                    if (!p.point_can_left(row, col) && p.point_can_up(row, col))
+                        p.vrt[row - 1][col] = puzzle::LINKED;
+                    if (p.point_can_left(row, col) && !p.point_can_up(row, col))
+                        p.hrz[row][col - 1] = puzzle::LINKED;
+                    if (!p.point_can_right(row + 1, col + 1) && p.point_can_down(row + 1, col + 1))
+                        p.vrt[row + 1][col + 1] = puzzle::LINKED;
+                    if (p.point_can_right(row + 1, col + 1) && !p.point_can_down(row + 1, col + 1))
+                        p.hrz[row + 1][col + 1] = puzzle::LINKED;
+                }
+            }
+        }
+    }
+}
+
+void puzzle_solver::link_around_three(puzzle &p)
+{
+    /**
+     * . l .
+     * x 3 l
+     * . l .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 3 &&
+                !p.complete_lat(row, col) &&
+                p.get_lat_banned_edge(row, col) == 1)
+            {
+                if (p.hrz[row][col] == puzzle::BAN)
+                {
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                else if (p.hrz[row + 1][col] == puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                else if (p.vrt[row][col] == puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                else if (p.vrt[row][col + 1] == puzzle::BAN)
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+            }
+        }
+    }
+    /**
+     *   x
+     * x . l .
+     *   l 3
+     *   .   .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 3 && !p.complete_lat(row, col))
+            {
+                if (!p.point_can_up(row, col) &&
+                    !p.point_can_left(row, col))
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+                if (!p.point_can_up(row, col + 1) &&
+                    !p.point_can_right(row, col + 1))
+                {
+                    p.hrz[row][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+                if (!p.point_can_down(row + 1, col) &&
+                    !p.point_can_left(row + 1, col))
+                {
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+                if (!p.point_can_down(row + 1, col + 1) &&
+                    !p.point_can_right(row + 1, col + 1))
+                {
+                    p.hrz[row + 1][col] = puzzle::LINKED;
+                    p.vrt[row][col + 1] = puzzle::LINKED;
+                }
+            }
+        }
+    }
+    /**
+     * - .   .
+     *     3 l
+     *   . l .
+     */
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] == 3 && !p.complete_lat(row, col))
+            {
+                if (p.point_has_edge_up(row, col) ||
+                    p.point_has_edge_left(row, col))
+                {
+                    if (p.hrz[row + 1][col] == puzzle::NOT &&
+                        p.vrt[row][col + 1] == puzzle::NOT)
+                    {
+                        p.hrz[row + 1][col] = puzzle::LINKED;
+                        p.vrt[row][col + 1] = puzzle::LINKED;
+                    }
+                }
+                if (p.point_has_edge_up(row, col + 1) ||
+                    p.point_has_edge_right(row, col + 1))
+                {
+                    if (p.hrz[row + 1][col] == puzzle::NOT &&
+                        p.vrt[row][col] == puzzle::NOT)
+                    {
+                        p.hrz[row + 1][col] = puzzle::LINKED;
+                        p.vrt[row][col] = puzzle::LINKED;
+                    }
+                }
+                if (p.point_has_edge_down(row + 1, col) ||
+                    p.point_has_edge_left(row + 1, col))
+                {
+                    if (p.hrz[row][col] == puzzle::NOT &&
+                        p.vrt[row][col + 1] == puzzle::NOT)
+                    {
+                        p.hrz[row][col] = puzzle::LINKED;
+                        p.vrt[row][col + 1] = puzzle::LINKED;
+                    }
+                }
+                if (p.point_has_edge_down(row + 1, col + 1) ||
+                    p.point_has_edge_right(row + 1, col + 1))
+                {
+                    if (p.hrz[row][col] == puzzle::NOT &&
+                        p.vrt[row][col] == puzzle::NOT)
+                    {
+                        p.hrz[row][col] = puzzle::LINKED;
+                        p.vrt[row][col] = puzzle::LINKED;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void puzzle_solver::link_around_point(puzzle &p)
+{
+    /**
+     *   x
+     * l . x
+     *   |
+     */
+    for (size_t row = win.top; row <= win.bottom; row++)
+    {
+        for (size_t col = win.left; col <= win.right; col++)
+        {
+            if (p.get_conn(row, col) == 1)
+            {
+                if (p.point_can_up(row, col) &&
+                    p.point_can_down(row, col) &&
+                    !p.point_can_left(row, col) &&
+                    !p.point_can_right(row, col))
+                {
+                    p.vrt[row - 1][col] = puzzle::LINKED;
+                    p.vrt[row][col] = puzzle::LINKED;
+                }
+                else if (p.point_can_up(row, col) &&
+                         !p.point_can_down(row, col) &&
+                         p.point_can_left(row, col) &&
+                         !p.point_can_right(row, col))
+                {
+                    p.vrt[row - 1][col] = puzzle::LINKED;
+                    p.hrz[row][col - 1] = puzzle::LINKED;
+                }
+                else if (p.point_can_up(row, col) &&
+                         !p.point_can_down(row, col) &&
+                         !p.point_can_left(row, col) &&
+                         p.point_can_right(row, col))
+                {
+                    p.vrt[row - 1][col] = puzzle::LINKED;
+                    p.hrz[row][col] = puzzle::LINKED;
+                }
+                else if (!p.point_can_up(row, col) &&
+                         p.point_can_down(row, col) &&
+                         p.point_can_left(row, col) &&
+                         !p.point_can_right(row, col))
+                {
+                    p.vrt[row][col] = puzzle::LINKED;
+                    p.hrz[row][col - 1] = puzzle::LINKED;
+                }
+                else if (!p.point_can_up(row, col) &&
+                         p.point_can_down(row, col) &&
+                         !p.point_can_left(row, col) &&
+                         p.point_can_right(row, col))
+                {
+                    p.vrt[row][col] = puzzle::LINKED;
+                    p.hrz[row][col] = puzzle::LINKED;
+                }
+                else if (!p.point_can_up(row, col) &&
+                         !p.point_can_down(row, col) &&
+                         p.point_can_left(row, col) &&
+                         p.point_can_right(row, col))
+                {
+                    p.hrz[row][col - 1] = puzzle::LINKED;
+                    p.hrz[row][col] = puzzle::LINKED;
+                }
+            }
+        }
+    }
+}
+
+bool puzzle_solver::ban_edge_off_block(puzzle &p, size_t &decided)
+{
+    /**
+     * . - . - .   .
+     * |       |   |     the loop is a cycle, and a cycle stays inside one
+     * . - a - . - b     block (split at articulation points a, b): bridges
+     *     |       |     and every block but the one holding the drawn
+     *     . - . - .     edges are banned, drawn edges in two blocks fail
+     */
+    const int cols = p.cols;
+    const int points = (p.rows + 1) * (cols + 1);
+    const int hrz_edges = (p.rows + 1) * cols;
+    auto usable = [&](int a, int b, puzzle::edge_state s)
+    {
+        return s != puzzle::BAN &&
+               !p.banned_point[a / (cols + 1)][a % (cols + 1)] &&
+               !p.banned_point[b / (cols + 1)][b % (cols + 1)];
+    };
+    // Edges of a point: neighbour and edge id
+    auto neighbours = [&](int v, pair<int, int> out[4])
+    {
+        const int r = v / (cols + 1);
+        const int c = v % (cols + 1);
+        int n = 0;
+        if (r > 0 && usable(v, v - cols - 1, p.vrt[r - 1][c]))
+            out[n++] = {v - cols - 1, hrz_edges + (r - 1) * (cols + 1) + c};
+        if (r < (int)p.rows && usable(v, v + cols + 1, p.vrt[r][c]))
+            out[n++] = {v + cols + 1, hrz_edges + r * (cols + 1) + c};
+        if (c > 0 && usable(v, v - 1, p.hrz[r][c - 1]))
+            out[n++] = {v - 1, r * cols + c - 1};
+        if (c < cols && usable(v, v + 1, p.hrz[r][c]))
+            out[n++] = {v + 1, r * cols + c};
+        return n;
+    };
+    // Tarjan, with an explicit stack so large boards do not overflow
+    struct frame
+    {
+        int v, in_edge, next, n;
+        pair<int, int> adj[4];
+    };
+    vector<int> disc(points, -1), low(points, 0);
+    vector<int> block(hrz_edges + p.rows * (cols + 1), -1);
+    vector<int> edges; // tree and back edges not yet given a block
+    vector<frame> stack;
+    int time = 0;
+    int blocks = 0;
+    for (int root = 0; root < points; root++)
+    {
+        if (disc[root] >= 0)
+            continue;
+        stack.push_back({root, -1, 0, 0, {}});
+        stack.back().n = neighbours(root, stack.back().adj);
+        disc[root] = low[root] = time++;
+        while (!stack.empty())
+        {
+            frame &f = stack.back();
+            if (f.next < f.n)
+            {
+                const auto [w, e] = f.adj[f.next++];
+                if (e == f.in_edge)
+                    continue;
+                if (disc[w] < 0)
+                {
+                    edges.push_back(e);
+                    disc[w] = low[w] = time++;
+                    stack.push_back({w, e, 0, 0, {}});
+                    stack.back().n = neighbours(w, stack.back().adj);
+                }
+                else if (disc[w] < disc[f.v])
+                {
+                    edges.push_back(e);
+                    low[f.v] = min(low[f.v], disc[w]);
+                }
+                continue;
+            }
+            const int v = f.v;
+            const int in_edge = f.in_edge;
+            stack.pop_back();
+            if (stack.empty())
+                break;
+            const int u = stack.back().v;
+            low[u] = min(low[u], low[v]);
+            if (low[v] >= disc[u])
+            {
+                // u splits off the block hanging from edge u-v
+                int e;
+                do
+                {
+                    e = edges.back();
+                    edges.pop_back();
+                    block[e] = blocks;
+                } while (e != in_edge);
+                blocks++;
+            }
+        }
+    }
+    vector<int> size(blocks, 0);
+    for (const int b : block)
+    {
+        if (b >= 0)
+            size[b]++;
+    }
+    int loop_block = -1;
+    for (size_t e = 0; e < block.size(); e++)
+    {
+        const bool horizontal = (int)e < hrz_edges;
+        const int i = horizontal ? e : e - hrz_edges;
+        const int row = horizontal ? i / cols : i / (cols + 1);
+        const int col = horizontal ? i % cols : i % (cols + 1);
+        if (p.at({horizontal, row, col}) != puzzle::LINKED)
+            continue;
+        if (block[e] < 0 || size[block[e]] == 1 || (loop_block >= 0 && block[e] != loop_block))
+            return false;
+        loop_block = block[e];
+    }
+    for (size_t e = 0; e < block.size(); e++)
+    {
+        if (block[e] < 0 || (loop_block >= 0 ? block[e] == loop_block : size[block[e]] > 1))
+            continue;
+        const bool horizontal = (int)e < hrz_edges;
+        const int i = horizontal ? e : e - hrz_edges;
+        p.at({horizontal, horizontal ? i / cols : i / (cols + 1), horizontal ? i % cols : i % (cols + 1)}) = puzzle::BAN;
+        decided++;
+    }
+    return true;
+}
+
+bool puzzle_solver::colour_cells(puzzle &p, size_t &decided)
+{
+    /**
+     * Every cell is inside or outside the loop, the border is outside.
+     *   . l .     a linked edge parts two colours, a banned one joins
+     *   a 2 b     them; with a ~ b here, c ~ d and a !~ c:
+     *   . d .     two of the four neighbours of a 2 differ from it
+     * Colours are kept as union-find with parity, rebuilt from the edges
+     * and grown with what the clues say about pairs of neighbours.
+     */
+    const int cols = p.cols;
+    const int rows = p.rows;
+    const int outside = rows * cols;
+    vector<int> parent(outside + 1);
+    vector<char> parity(outside + 1, 0); // differs from parent
+    for (int i = 0; i <= outside; i++)
+        parent[i] = i;
+    auto find = [&](int x, int &d)
+    {
+        d = 0;
+        int root = x;
+        while (parent[root] != root)
+        {
+            d ^= parity[root];
+            root = parent[root];
+        }
+        // compress, keeping each node's parity to the root
+        int rest = d;
+        while (parent[x] != root)
+        {
+            const int up = parent[x];
+            const int next = rest ^ parity[x];
+            parent[x] = root;
+            parity[x] = rest;
+            x = up;
+            rest = next;
+        }
+        return root;
+    };
+    bool grown = false;
+    bool ok = true;
+    auto unite = [&](int a, int b, int differ)
+    {
+        if (a < 0 || b < 0)
+            return;
+        int da, db;
+        const int ra = find(a, da);
+        const int rb = find(b, db);
+        if (ra == rb)
+        {
+            ok = ok && (da ^ db) == differ;
+            return;
+        }
+        parent[ra] = rb;
+        parity[ra] = da ^ db ^ differ;
+        grown = true;
+    };
+    // In a tile a side is the border only where the tile reaches it
+    auto cell = [&](int row, int col)
+    {
+        if (row >= 0 && col >= 0 && row < rows && col < cols)
+            return row * cols + col;
+        if (!tile || (row < 0 && win.top == 0) || (col < 0 && win.left == 0) ||
+            (row == rows && win.bottom == p.rows) || (col == cols && win.right == p.cols))
+            return outside;
+        return -1;
+    };
+    auto sides = [&](const puzzle::edge &e, int &a, int &b)
+    {
+        a = e.horizontal ? cell(e.row - 1, e.col) : cell(e.row, e.col - 1);
+        b = cell(e.row, e.col);
+    };
+    auto each_edge = [&](auto f)
+    {
+        for (int row = 0; row <= rows; row++)
+        {
+            for (int col = 0; col <= cols; col++)
+            {
+                if (col < cols)
+                    f(puzzle::edge{true, row, col});
+                if (row < rows)
+                    f(puzzle::edge{false, row, col});
+            }
+        }
+    };
+    each_edge([&](const puzzle::edge &e)
+              {
+                  int a, b;
+                  sides(e, a, b);
+                  if (p.at(e) != puzzle::NOT)
+                      unite(a, b, p.at(e) == puzzle::LINKED); });
+    do
+    {
+        grown = false;
+        for (size_t row = win.top; row < win.bottom && ok; row++)
+        {
+            for (size_t col = win.left; col < win.right; col++)
+            {
+                const int clue = p.lat[row][col];
+                if (clue < 1 || clue > 3)
+                    continue;
+                const int c = row * cols + col;
+                const int n[4] = {cell(row - 1, col), cell(row, col + 1),
+                                  cell(row + 1, col), cell(row, col - 1)};
+                for (int i = 0; i < 4; i++)
+                {
+                    for (int j = i + 1; j < 4; j++)
+                    {
+                        int di, dj;
+                        if (n[i] < 0 || n[j] < 0 || find(n[i], di) != find(n[j], dj))
+                            continue;
+                        // the other two neighbours
+                        int k = 0;
+                        while (k == i || k == j)
+                            k++;
+                        const int l = 6 - i - j - k;
+                        if ((di ^ dj) == 0)
+                        {
+                            // a pair alike: both differ from a 3, both match a 1,
+                            // the other two of a 2 are alike and unlike them
+                            if (clue == 1 || clue == 3)
+                            {
+                                unite(c, n[i], clue == 3);
+                                unite(c, n[j], clue == 3);
+                            }
+                            else
+                            {
+                                unite(n[k], n[l], 0);
+                                unite(n[i], n[k], 1);
+                            }
+                        }
+                        else
+                        {
+                            // a pair unlike: just one of them differs from the
+                            // cell, so the other two split the clue's rest
+                            if (clue == 1 || clue == 3)
+                            {
+                                unite(c, n[k], clue == 3);
+                                unite(c, n[l], clue == 3);
+                            }
+                            else
+                            {
+                                unite(n[k], n[l], 1);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    } while (grown && ok);
+    if (!ok)
+        return false;
+    each_edge([&](const puzzle::edge &e)
+              {
+                  int a, b, da, db;
+                  sides(e, a, b);
+                  if (p.at(e) != puzzle::NOT || a < 0 || b < 0 || find(a, da) != find(b, db))
+                      return;
+                  p.at(e) = (da ^ db) ? puzzle::LINKED : puzzle::BAN;
+                  decided++; });
+    return true;
+}
+
+void puzzle_solver::memo_sync(probe_memo &memo, const puzzle &p)
+{
+    if (memo.changed.empty())
+    {
+        memo.seen = p;
+        memo.changed.assign(p.rows, vector<size_t>(p.cols, 0));
+        memo.hrz.assign(p.rows + 1, vector<probe_reach>(p.cols));
+        memo.vrt.assign(p.rows, vector<probe_reach>(p.cols + 1));
+        memo.two.assign(p.rows, vector<probe_reach>(p.cols));
+        memo.end.assign(p.rows + 1, vector<probe_reach>(p.cols + 1));
+        return;
+    }
+    memo.clock++;
+    for (size_t row = 0; row <= p.rows; row++)
+    {
+        for (size_t col = 0; col < p.cols; col++)
+        {
+            if (p.hrz[row][col] != memo.seen.hrz[row][col])
+            {
+                if (row > 0)
+                    memo.changed[row - 1][col] = memo.clock;
+                if (row < p.rows)
+                    memo.changed[row][col] = memo.clock;
+            }
+        }
+    }
+    for (size_t row = 0; row < p.rows; row++)
+    {
+        for (size_t col = 0; col <= p.cols; col++)
+        {
+            if (p.vrt[row][col] != memo.seen.vrt[row][col])
+            {
+                if (col > 0)
+                    memo.changed[row][col - 1] = memo.clock;
+                if (col < p.cols)
+                    memo.changed[row][col] = memo.clock;
+            }
+        }
+    }
+    memo.seen = p;
+}
+
+bool puzzle_solver::memo_stale(const probe_memo &memo, const probe_reach &reach)
+{
+    if (reach.stamp == 0)
+        return true;
+    // rules read one cell past what they write
+    const int top = max(reach.top - 1, 0);
+    const int left = max(reach.left - 1, 0);
+    const int bottom = min<int>(reach.bottom + 1, memo.changed.size() - 1);
+    const int right = min<int>(reach.right + 1, memo.changed[0].size() - 1);
+    for (int row = top; row <= bottom; row++)
+    {
+        for (int col = left; col <= right; col++)
+        {
+            if (memo.changed[row][col] > reach.stamp)
+                return true;
+        }
+    }
+    return false;
+}
+
+void puzzle_solver::memo_probe(probe_memo &memo, probe_reach &reach, const puzzle::edge &e)
+{
+    const int rows = memo.changed.size();
+    const int cols = memo.changed[0].size();
+    reach.stamp = memo.clock;
+    reach.top = min(e.horizontal ? max(e.row - 1, 0) : e.row, rows - 1);
+    reach.left = min(e.horizontal ? e.col : max(e.col - 1, 0), cols - 1);
+    reach.bottom = min(e.row, rows - 1);
+    reach.right = min(e.col, cols - 1);
+}
+
+void puzzle_solver::memo_extend(probe_reach &reach, const puzzle &p, const puzzle &np)
+{
+    for (size_t row = 0; row <= p.rows; row++)
+    {
+        for (size_t col = 0; col < p.cols; col++)
+        {
+            if (p.hrz[row][col] != np.hrz[row][col])
+            {
+                reach.top = min<int>(reach.top, row > 0 ? row - 1 : 0);
+                reach.bottom = max<int>(reach.bottom, row < p.rows ? row : row - 1);
+                reach.left = min<int>(reach.left, col);
+                reach.right = max<int>(reach.right, col);
+            }
+        }
+    }
+    for (size_t row = 0; row < p.rows; row++)
+    {
+        for (size_t col = 0; col <= p.cols; col++)
+        {
+            if (p.vrt[row][col] != np.vrt[row][col])
+            {
+                reach.top = min<int>(reach.top, row);
+                reach.bottom = max<int>(reach.bottom, row);
+                reach.left = min<int>(reach.left, col > 0 ? col - 1 : 0);
+                reach.right = max<int>(reach.right, col < p.cols ? col : col - 1);
+            }
+        }
+    }
+}
+
+size_t puzzle_solver::commit_common(puzzle &p, const vector<const puzzle *> &alive)
+{
+    // Whatever every possible branch decided the same way is forced
+    size_t decided = 0;
+    for (size_t row = 0; row <= p.rows; row++)
+    {
+        for (size_t col = 0; col <= p.cols; col++)
+        {
+            for (const bool horizontal : {true, false})
+            {
+                if (horizontal ? col == p.cols : row == p.rows)
+                    continue;
+                const puzzle::edge e{horizontal, int(row), int(col)};
+                if (p.at(e) != puzzle::NOT)
+                    continue;
+                const auto s = alive[0]->at(e);
+                if (s == puzzle::NOT)
+                    continue;
+                bool same = true;
+                for (size_t i = 1; i < alive.size() && same; i++)
+                    same = alive[i]->at(e) == s;
+                if (same)
+                {
+                    p.at(e) = s;
+                    decided++;
+                }
+            }
+        }
+    }
+    return decided;
+}
+
+bool puzzle_solver::try_draw(puzzle &p, size_t level, probe_memo &memo)
+{
+    trace_span span(opt.trace, "try_draw", "probe");
+    if (opt.trace != nullptr)
+        span.args = "\"level\":" + to_string(level);
+    if (level > 1)
+    {
+        return try_draw_deep(p, level);
+    }
+    memo_sync(memo, p);
+    // Keeps what every branch that is still possible agrees on
+    bool hit = false;
+    auto settle = [&](const vector<const puzzle *> &alive)
+    {
+        if (alive.empty())
+            return false;
+        if (commit_common(p, alive) > 0)
+        {
+            hit = true;
+            if (heuristic(p, 0) == false)
+                return false;
+            memo_sync(memo, p);
+        }
+        return true;
+    };
+    // Both states of one edge
+    auto probe_edge = [&](const puzzle::edge &e, probe_reach &reach)
+    {
+        memo_probe(memo, reach, e);
+        vector<puzzle> tried(2, p);
+        vector<const puzzle *> alive;
+        tried[0].at(e) = puzzle::BAN;
+        tried[1].at(e) = puzzle::LINKED;
+        for (auto &t : tried)
+        {
+            probes++;
+            if (heuristic(t, 0))
+                alive.push_back(&t);
+            memo_extend(reach, p, t);
+        }
+        return settle(alive);
+    };
+    // line ends: the line goes on by exactly one of two or three ways
+    auto end_ways = [&](size_t row, size_t col)
+    {
+        vector<puzzle::edge> ways;
+        if (p.point_can_up(row, col) && p.vrt[row - 1][col] == puzzle::NOT)
+            ways.push_back({false, int(row) - 1, int(col)});
+        if (p.point_can_down(row, col) && p.vrt[row][col] == puzzle::NOT)
+            ways.push_back({false, int(row), int(col)});
+        if (p.point_can_left(row, col) && p.hrz[row][col - 1] == puzzle::NOT)
+            ways.push_back({true, int(row), int(col) - 1});
+        if (p.point_can_right(row, col) && p.hrz[row][col] == puzzle::NOT)
+            ways.push_back({true, int(row), int(col)});
+        return ways;
+    };
+    auto probe_end = [&](size_t row, size_t col, probe_reach &reach)
+    {
+        const auto ways = end_ways(row, col);
+        memo_probe(memo, reach, ways[0]);
+        vector<puzzle> tried(ways.size(), p);
+        vector<const puzzle *> alive;
+        for (size_t i = 0; i < ways.size(); i++)
+        {
+            tried[i].at(ways[i]) = puzzle::LINKED;
+            probes++;
+            if (heuristic(tried[i], 0))
+                alive.push_back(&tried[i]);
+            memo_extend(reach, p, tried[i]);
+        }
+        // probing these edges one by one would learn nothing more
+        for (const auto &e : ways)
+        {
+            probe_reach &r = (e.horizontal ? memo.hrz : memo.vrt)[e.row][e.col];
+            r.stamp = reach.stamp;
+            r.top = reach.top;
+            r.left = reach.left;
+            r.bottom = reach.bottom;
+            r.right = reach.right;
+        }
+        return settle(alive);
+    };
+    auto probe_two = [&](size_t row, size_t col, probe_reach &reach)
+    {
+        memo_probe(memo, reach, {true, int(row), int(col)});
+        /**
+         * . 0 .
+         * 3   1   two of the four edges of the 2, six ways
+         * . 2 .
+         */
+        const puzzle::edge edges[4] = {{true, int(row), int(col)},
+                                       {false, int(row), int(col + 1)},
+                                       {true, int(row + 1), int(col)},
+                                       {false, int(row), int(col)}};
+        const int pick[6][2] = {{0, 3}, {0, 1}, {2, 1}, {2, 3}, {0, 2}, {3, 1}};
+        vector<puzzle> tried(6, p);
+        vector<const puzzle *> alive;
+        for (size_t i = 0; i < 6; i++)
+        {
+            tried[i].at(edges[pick[i][0]]) = puzzle::LINKED;
+            tried[i].at(edges[pick[i][1]]) = puzzle::LINKED;
+            probes++;
+            if (heuristic(tried[i], 0))
+                alive.push_back(&tried[i]);
+            memo_extend(reach, p, tried[i]);
+        }
+        return settle(alive);
+    };
+
+    /**
+     * Candidates go best first: what they decided per probe so far in
+     * this memo, their kind's rate standing in before they have a record,
+     * times how busy their cells are
+     *
+     *   clue              +1 a cell
+     *   changed lately    +2 a cell
+     *   line end          +2 a point
+     *
+     * The first probe that decides an edge ends the pass, the next one
+     * scores the candidates again on the new board.
+     */
+    struct candidate
+    {
+        double score;
+        size_t seq; // scan order, breaks ties
+        probe_kind kind;
+        int row, col;
+        bool operator<(const candidate &o) const
+        {
+            return score != o.score ? score < o.score : seq > o.seq;
+        }
+    };
+    auto heat = [&](int top, int left, int bottom, int right)
+    {
+        int h = 0;
+        for (int row = max(top, 0); row <= min<int>(bottom, p.rows - 1); row++)
+        {
+            for (int col = max(left, 0); col <= min<int>(right, p.cols - 1); col++)
+            {
+                if (p.lat[row][col] >= 0)
+                    h += 1;
+                if (memo.changed[row][col] > 0 && memo.changed[row][col] + 1 >= memo.clock)
+                    h += 2;
+            }
+        }
+        return h;
+    };
+    auto end_heat = [&](int row, int col)
+    {
+        return p.get_conn(row, col) == 1 ? 2 : 0;
+    };
+    auto reach_of = [&](probe_kind kind, int row, int col) -> probe_reach &
+    {
+        switch (kind)
+        {
+        case PROBE_END:
+            return memo.end[row][col];
+        case PROBE_HRZ:
+            return memo.hrz[row][col];
+        case PROBE_VRT:
+            return memo.vrt[row][col];
+        default:
+            return memo.two[row][col];
+        }
+    };
+    priority_queue<candidate> todo;
+    auto add = [&](probe_kind kind, int row, int col, int h)
+    {
+        const probe_reach &reach = reach_of(kind, row, col);
+        if (!memo_stale(memo, reach))
+            return;
+        // The candidate's own record, its kind's rate counting as one run
+        const auto &y = yields[kind];
+        const double prior = (y.hits + 1.0) / (y.tries + 2.0);
+        const double rate = (reach.hits + prior) / (reach.tries + 1.0);
+        todo.push({rate * (1 + h), todo.size(), kind, row, col});
+    };
+    for (int row = win.top; row <= int(win.bottom); row++)
+    {
+        for (int col = win.left; col <= int(win.right); col++)
+        {
+            if (p.get_conn(row, col) == 1 && end_ways(row, col).size() >= 2)
+                add(PROBE_END, row, col, heat(row - 1, col - 1, row, col) + 2);
+        }
+    }
+    for (int row = win.top; row <= int(win.bottom); row++)
+    {
+        for (int col = max<int>(win.left, 1); col < int(win.right); col++)
+        {
+            if (p.hrz[row][col] == puzzle::NOT)
+                add(PROBE_HRZ, row, col, heat(row - 1, col, row, col) + end_heat(row, col) + end_heat(row, col + 1));
+        }
+    }
+    for (int row = win.top; row < int(win.bottom); row++)
+    {
+        for (int col = max<int>(win.left, 1); col <= int(win.right); col++)
+        {
+            if (p.vrt[row][col] == puzzle::NOT)
+                add(PROBE_VRT, row, col, heat(row, col - 1, row, col) + end_heat(row, col) + end_heat(row + 1, col));
+        }
+    }
+    for (int row = win.top; row < int(win.bottom); row++)
+    {
+        for (int col = max<int>(win.left, 1); col < int(win.right); col++)
+        {
+            if (p.lat[row][col] == 2 &&
+                p.lat_edge(row, col) == 0 &&
+                p.get_lat_banned_edge(row, col) == 0)
+                add(PROBE_TWO, row, col, heat(row - 1, col - 1, row + 1, col + 1));
+        }
+    }
+    while (!todo.empty())
+    {
+        if (out_of_budget())
+            return true;
+        const candidate c = todo.top();
+        todo.pop();
+        probe_reach &reach = reach_of(c.kind, c.row, c.col);
+        // a line end probe may have covered this edge already
+        if (!memo_stale(memo, reach))
+            continue;
+        const size_t spent = probes;
+        bool ok = false;
+        switch (c.kind)
+        {
+        case PROBE_END:
+            ok = probe_end(c.row, c.col, reach);
+            break;
+        case PROBE_HRZ:
+            ok = probe_edge({true, c.row, c.col}, reach);
+            break;
+        case PROBE_VRT:
+            ok = probe_edge({false, c.row, c.col}, reach);
+            break;
+        default:
+            ok = probe_two(c.row, c.col, reach);
+            break;
+        }
+        if (!ok)
+            return false;
+        yields[c.kind].tries += probes - spent;
+        reach.tries += probes - spent;
+        if (hit)
+        {
+            yields[c.kind].hits++;
+            reach.hits++;
+            return true;
+        }
+    }
+    return true;
+}
+
+bool puzzle_solver::try_draw_deep(puzzle &p, size_t level)
+{
+    // Candidates: edges at line ends first, then edges around open clues
+    vector<puzzle::edge> todo;
+    vector<vector<bool>> seen_hrz(p.rows + 1, vector<bool>(p.cols, false));
+    vector<vector<bool>> seen_vrt(p.rows, vector<bool>(p.cols + 1, false));
+    auto add = [&](const bool horizontal, const int row, const int col)
+    {
+        auto &seen = horizontal ? seen_hrz : seen_vrt;
+        if (seen[row][col] || p.at({horizontal, row, col}) != puzzle::NOT)
+            return;
+        seen[row][col] = true;
+        todo.push_back({horizontal, row, col});
+    };
+    for (size_t row = win.top; row <= win.bottom; row++)
+    {
+        for (size_t col = win.left; col <= win.right; col++)
+        {
+            if (p.get_conn(row, col) == 1)
+            {
+                if (p.point_can_up(row, col))
+                    add(false, row - 1, col);
+                if (p.point_can_down(row, col))
+                    add(false, row, col);
+                if (p.point_can_left(row, col))
+                    add(true, row, col - 1);
+                if (p.point_can_right(row, col))
+                    add(true, row, col);
+            }
+        }
+    }
+    for (size_t row = win.top; row < win.bottom; row++)
+    {
+        for (size_t col = win.left; col < win.right; col++)
+        {
+            if (p.lat[row][col] > 0 && !p.complete_lat(row, col))
+            {
+                add(true, row, col);
+                add(true, row + 1, col);
+                add(false, row, col);
+                add(false, row, col + 1);
+            }
+        }
+    }
+    // Probe inside probe, until this level's budget is spent
+    probe_level &stat = levels[level];
+    const size_t start = probes;
+    bool found = false;
+    for (const auto &e : todo)
+    {
+        if (probes - start >= stat.budget || out_of_budget())
+            break;
+        if (p.at(e) != puzzle::NOT)
+            continue;
+        puzzle ban_p = p;
+        ban_p.at(e) = puzzle::BAN;
+        probes++;
+        const bool no_ban = heuristic(ban_p, level - 1) == false;
+        puzzle link_p = p;
+        link_p.at(e) = puzzle::LINKED;
+        probes++;
+        const bool no_link = heuristic(link_p, level - 1) == false;
+        if (no_link && no_ban)
+        {
+            return false;
+        }
+        vector<const puzzle *> alive;
+        if (!no_ban)
+            alive.push_back(&ban_p);
+        if (!no_link)
+            alive.push_back(&link_p);
+        if (commit_common(p, alive) > 0)
+        {
+            if (heuristic(p, 0) == false)
+                return false;
+            found = true;
+        }
+    }
+    // Spend more where deep probes pay off, less where they do not
+    stat.passes++;
+    if (found)
+    {
+        stat.hits++;
+        stat.budget = min(stat.budget * 2, opt.probe_budget * 16);
+    }
+    else
+    {
+        stat.budget = max<size_t>(stat.budget / 2, opt.probe_budget / 16 + 1);
+    }
+    return true;
+}
+
+bool puzzle_solver::step()
+{
+    if (stopped || enough)
+        return false;
+    if (checkpoint_due || (opt.checkpoint_now != nullptr && opt.checkpoint_now->load()))
+        write_checkpoint();
+    if (frames.empty())
+    {
+        // For every points find all solutions
+        if (!root_scan)
+            return false;
+        // Optimized
+        if (root_col > p.cols)
+        {
+            root_row++;
+            root_col = 1;
+        }
+        if (root_row > p.rows)
+        {
+            root_scan = false;
+            return false;
+        }
+        go_without_line(p, root_row, root_col, root_row, root_col, true);
+        if (frames.empty())
+            end_root_start();
+        return true;
+    }
+    auto &f = frames.back();
+    const auto &order = way_orders()[f.order];
+    auto way = [&](int dir, puzzle::edge &e, int &r, int &c)
+    {
+        r = f.r;
+        c = f.c;
+        switch (order[dir])
+        {
+        case 0:
+            e = {false, --r, c};
+            return f.p.point_can_up(f.r, f.c);
+        case 1:
+            e = {false, r++, c};
+            return f.p.point_can_down(f.r, f.c);
+        case 2:
+            e = {true, r, --c};
+            return f.p.point_can_left(f.r, f.c);
+        default:
+            e = {true, r, c++};
+            return f.p.point_can_right(f.r, f.c);
+        }
+    };
+    const size_t at = frames.size();
+    while (f.dir < 4)
+    {
+        int r, c;
+        puzzle::edge way_e;
+        const int dir = f.dir++;
+        if (!way(dir, way_e, r, c) || f.p.at(way_e) != puzzle::NOT)
+            continue;
+        const auto e = &f.p.at(way_e);
+        taken = way_e;
+        taken_at = at;
+        puzzle np = f.p;
+        const int start_r = f.start_r, start_c = f.start_c;
+        const int src_r = f.r, src_c = f.c;
+        // A loop leaves a fresh start point by two edges; once one has been
+        // tried it is banned, so later tries do not find the same loops again
+        if (f.fresh)
+        {
+            *e = puzzle::BAN;
+            int left = 0;
+            for (int dir = f.dir; dir < 4; dir++)
+            {
+                int nr, nc;
+                puzzle::edge o;
+                left += way(dir, o, nr, nc) && f.p.at(o) == puzzle::NOT;
+            }
+            if (left < 2)
+                f.dir = 4;
+        }
+        // f is gone once draw_line pushes
+        draw_line(move(np), start_r, start_c, src_r, src_c, r, c);
+        // A node cut short by a limit is tried again on resume
+        if (stopped && frames.size() == at)
+        {
+            frames.back().dir = dir;
+            *e = puzzle::NOT;
+        }
+        return true;
+    }
+    // All ways from here tried
+    if (f.root)
+    {
+        p = move(f.p);
+        frames.pop_back();
+        end_root_start();
+    }
+    else
+    {
+        frames.pop_back();
+    }
+    return true;
+}
+
+void puzzle_solver::write_checkpoint()
+{
+    checkpoint_due = false;
+    if (opt.checkpoint_now != nullptr)
+        opt.checkpoint_now->store(false);
+    last_checkpoint = chrono::steady_clock::now();
+    if (opt.checkpoint_file.empty())
+        return;
+    // Never leave a half written checkpoint in place of the last good one
+    const string tmp = opt.checkpoint_file + ".tmp";
+    {
+        ofstream os(tmp, ios::binary);
+        save_checkpoint(os);
+        if (!os.flush())
+        {
+            cerr << tmp << ": cannot write checkpoint\n";
+            return;
+        }
+    }
+    if (rename(tmp.c_str(), opt.checkpoint_file.c_str()) != 0)
+        cerr << opt.checkpoint_file << ": cannot write checkpoint\n";
+}
+
+void puzzle_solver::save_checkpoint(ostream &os)
+{
+    os << "CHECKPOINT 2 " << p.cols << " " << p.rows << "\n";
+    for (const auto &row : p.lat)
+    {
+        for (const int clue : row)
+            os << (clue < 0 ? '.' : char('0' + clue));
+        os << "\n";
+    }
+    os << solution_count << " " << nodes << " " << probes << " "
+       << root_scan << " " << root_row << " " << root_col << " " << pending.size() << "\n";
+    os << levels.size();
+    for (const auto &level : levels)
+        os << " " << level.budget << " " << level.passes << " " << level.hits;
+    os << "\n";
+    os << pack_state(p);
+    for (const auto &q : pending)
+        os << pack_state(q);
+    os << frames.size() << "\n";
+    for (const auto &f : frames)
+    {
+        os << f.start_r << " " << f.start_c << " " << f.r << " " << f.c << " "
+           << f.dir << " " << f.order << " " << f.fresh << " " << f.root << "\n";
+        os << pack_state(f.p);
+    }
+    os << puzzle_results.size() << "\n";
+    for (const auto &key : puzzle_results)
+        os << key;
+}
+
+bool puzzle_solver::resume(istream &is)
+{
+    string magic;
+    int version;
+    size_t cols, rows;
+    if (!(is >> magic >> version >> cols >> rows) ||
+        magic != "CHECKPOINT" || version != 2 || cols != p.cols || rows != p.rows)
+        return false;
+    for (const auto &row : p.lat)
+    {
+        string line;
+        if (!(is >> line) || line.size() != cols)
+            return false;
+        for (size_t col = 0; col < cols; col++)
+        {
+            if (line[col] != (row[col] < 0 ? '.' : char('0' + row[col])))
+                return false;
+        }
+    }
+    prepare();
+    size_t queued, count;
+    if (!(is >> solution_count >> nodes >> probes >> root_scan >> root_row >> root_col >> queued >> count))
+        return false;
+    resumed_nodes = nodes;
+    // Budgets of levels this run does not probe are dropped
+    for (size_t i = 0; i < count; i++)
+    {
+        probe_level level;
+        if (!(is >> level.budget >> level.passes >> level.hits))
+            return false;
+        if (i < levels.size())
+            levels[i] = level;
+    }
+    if (!end_line(is) || !unpack_state(is, p))
+        return false;
+    pending.assign(queued, p);
+    for (auto &q : pending)
+    {
+        if (!unpack_state(is, q))
+            return false;
+    }
+    if (!(is >> count))
+        return false;
+    frames.assign(count, search_frame());
+    for (auto &f : frames)
+    {
+        f.p = p;
+        if (!(is >> f.start_r >> f.start_c >> f.r >> f.c >> f.dir >> f.order >> f.fresh >> f.root) ||
+            f.order >= way_orders().size() ||
+            !end_line(is) || !unpack_state(is, f.p))
+            return false;
+    }
+    if (!(is >> count) || !end_line(is))
+        return false;
+    string key(p.packed().size(), '\0');
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is.read(&key[0], key.size()))
+            return false;
+        puzzle_results.insert(key);
+    }
+    best = p;
+    return true;
+}
+
+vector<string> puzzle_solver::split(size_t n)
+{
+    vector<string> pieces;
+    if (n == 0 || (!begun && start() == false))
+        return pieces;
+    deque<search_frame> work(make_move_iterator(frames.begin()), make_move_iterator(frames.end()));
+    frames.clear();
+    // Every start point of an empty board is a piece of its own; the
+    // points before it are banned on its board
+    while (root_scan && step())
+    {
+        if (frames.empty())
+            continue;
+        frames.back().root = false;
+        work.push_back(move(frames.back()));
+        frames.pop_back();
+        end_root_start();
+    }
+    // Subtrees differ a lot in size, so cut finer than asked and deal the
+    // frames out in turn. A frame has three ways on at most, take the
+    // children of the oldest
+    const size_t target = n * 8;
+    while (!work.empty() && work.size() + 2 <= target)
+    {
+        frames.push_back(move(work.front()));
+        work.pop_front();
+        while (!frames.empty())
+        {
+            if (frames.size() > 1)
+            {
+                work.push_back(move(frames.back()));
+                frames.pop_back();
+            }
+            else if (!step())
+            {
+                break;
+            }
+        }
+        // Stopped by a limit, what was left is still work
+        for (auto &f : frames)
+            work.push_back(move(f));
+        frames.clear();
+        if (stopped || enough)
+            break;
+    }
+    if (enough)
+        return pieces;
+    // Pieces start with no solutions or nodes of their own
+    const size_t found = solution_count, spent = nodes;
+    auto keys = move(puzzle_results);
+    puzzle_results.clear();
+    solution_count = 0;
+    nodes = 0;
+    pending.clear();
+    const size_t count = min(n, work.size() + root_scan);
+    vector<vector<search_frame>> groups(count);
+    for (size_t i = 0; i < work.size(); i++)
+        groups[i % count].push_back(move(work[i]));
+    for (auto &group : groups)
+    {
+        frames = move(group);
+        ostringstream os;
+        save_checkpoint(os);
+        pieces.push_back(os.str());
+        // Start points a limit left untried go with the first piece
+        root_scan = false;
+    }
+    frames.clear();
+    solution_count = found;
+    nodes = spent;
+    puzzle_results = move(keys);
+    return pieces;
+}
+
+void puzzle_solver::end_root_start()
+{
+    // set point banned
+    p.banned_point[root_row][root_col - 1] = true;
+    p.banned_point[root_row][root_col] = true;
+    if (root_col + 1 == p.cols)
+        p.banned_point[root_row][root_col + 1] = true;
+    root_col += 2;
+}
+
+void puzzle_solver::go_with_line(puzzle p,
+                                 const int &start_r, const int &start_c,
+                                 int src_p_r, int src_p_c,
+                                 int dst_p_r, int dst_p_c)
+{
+    // A closed loop that misses the start must not be walked for ever
+    const int first_r = dst_p_r;
+    const int first_c = dst_p_c;
+    bool walked = false;
+    while (p.get_conn(dst_p_r, dst_p_c) == 2) // with line
+    {
+        // If solved
+        if (dst_p_r == start_r && dst_p_c == start_c)
+        {
+            // Do final check
+            const auto c = p.check();
+            if (c.fin() && c.correct())
+            {
+                report(p);
+            }
+            return;
+        }
+        if (walked && dst_p_r == first_r && dst_p_c == first_c)
+            return;
+        walked = true;
+        // one step
+        if (p.point_can_up(dst_p_r, dst_p_c) &&
+            p.vrt_has_edge(dst_p_r - 1, dst_p_c) &&
+            dst_p_r - 1 != src_p_r)
+        {
+            src_p_r = dst_p_r;
+            src_p_c = dst_p_c;
+            --dst_p_r;
+        }
+        else if (p.point_can_down(dst_p_r, dst_p_c) &&
+                 p.vrt_has_edge(dst_p_r, dst_p_c) &&
+                 dst_p_r + 1 != src_p_r)
+        {
+            src_p_r = dst_p_r;
+            src_p_c = dst_p_c;
+            ++dst_p_r;
+        }
+        else if (p.point_can_left(dst_p_r, dst_p_c) &&
+                 p.hrz_has_edge(dst_p_r, dst_p_c - 1) &&
+                 dst_p_c - 1 != src_p_c)
+        {
+            src_p_r = dst_p_r;
+            src_p_c = dst_p_c;
+            --dst_p_c;
+        }
+        else if (p.point_can_right(dst_p_r, dst_p_c) &&
+                 p.hrz_has_edge(dst_p_r, dst_p_c) &&
+                 dst_p_c + 1 != src_p_c)
+        {
+            src_p_r = dst_p_r;
+            src_p_c = dst_p_c;
+            ++dst_p_c;
+        }
+    }
+    // without line
+    go_without_line(move(p),
+                    start_r, start_c,
+                    dst_p_r, dst_p_c);
+}
+
+void puzzle_solver::go_without_line(puzzle p,
+                                    const int &start_r, const int &start_c,
+                                    const int &dst_p_r, const int &dst_p_c,
+                                    bool root)
+{
+    const bool fresh = p.get_conn(dst_p_r, dst_p_c) == 0;
+    const int open = (p.point_can_up(dst_p_r, dst_p_c) && p.vrt[dst_p_r - 1][dst_p_c] == puzzle::NOT) +
+                     (p.point_can_down(dst_p_r, dst_p_c) && p.vrt[dst_p_r][dst_p_c] == puzzle::NOT) +
+                     (p.point_can_left(dst_p_r, dst_p_c) && p.hrz[dst_p_r][dst_p_c - 1] == puzzle::NOT) +
+                     (p.point_can_right(dst_p_r, dst_p_c) && p.hrz[dst_p_r][dst_p_c] == puzzle::NOT);
+    if (fresh && open < 2)
+        return;
+    // The ways on are tried one per step
+    const size_t order = shuffle ? rng() % way_orders().size() : 0;
+    frames.push_back({move(p), start_r, start_c, dst_p_r, dst_p_c, 0, order, fresh, root});
+}
+
+void puzzle_solver::draw_line(puzzle p,
+                              const int &start_r, const int &start_c,
+                              const int &src_p_r, const int &src_p_c,
+                              const int &dst_p_r, const int &dst_p_c)
+{
+    // Progress reports look at the node being deduced
+    struct node_guard
+    {
+        puzzle_solver &s;
+        ~node_guard()
+        {
+            s.current = nullptr;
+        }
+    } guard{*this};
+    depth = frames.size() + 1;
+    current = &p;
+    trace_span span(opt.trace, "draw_line", "dfs");
+    if (opt.trace != nullptr)
+        span.args = "\"depth\":" + to_string(depth);
+    nodes++;
+    if (out_of_budget())
+        return;
+    if (src_p_r == dst_p_r) // previous go horizontally
+    {
+        int h_r, h_c;
+        if (src_p_c > dst_p_c) // previous go left
+        {
+            h_r = dst_p_r;
+            h_c = dst_p_c;
+        }
+        else // previous go right
+        {
+            h_r = src_p_r;
+            h_c = src_p_c;
+        }
+        // Draw line
+        p.hrz[h_r][h_c] = puzzle::LINKED;
+        // Check lattice
+        if (!p.hrz_sat(h_r, h_c))
+            return;
+    }
+    else // previous go vertically
+    {
+        int v_r, v_c;
+        if (src_p_r > dst_p_r) // previous go up
+        {
+            v_r = dst_p_r;
+            v_c = dst_p_c;
+        }
+        else // previous go down
+        {
+            v_r = src_p_r;
+            v_c = src_p_c;
+        }
+        // Draw line
+        p.vrt[v_r][v_c] = puzzle::LINKED;
+        // Check lattice
+        if (!p.vrt_sat(v_r, v_c))
+            return;
+    }
+    // Check connectivity
+    if (p.get_conn(dst_p_r, dst_p_c) > 2 || p.get_conn(dst_p_r, dst_p_c) == 0)
+        return;
+    // Do heuristic
+    if (heuristic(p, opt.probe_depth) == false)
+        return;
+    if (opt.trace != nullptr)
+        opt.trace->counter("edges decided", "edges", p.decided_count());
+    if (stopped || enough)
+        return;
+    if (!symmetries.empty() && !lex_leader(p, false))
+        return;
+    keep_best(p);
+    // If solved
+    if (dst_p_r == start_r && dst_p_c == start_c)
+    {
+        // Do final check
+        const auto c = p.check();
+        if (c.fin() && c.correct())
+        {
+            report(p);
+        }
+        return;
+    }
+    // Go next point
+    if (p.get_conn(dst_p_r, dst_p_c) == 2)
+    {
+        go_with_line(move(p), start_r, start_c, src_p_r, src_p_c, dst_p_r, dst_p_c);
+    }
+    else // 1
+    {
+        go_without_line(move(p), start_r, start_c, dst_p_r, dst_p_c);
+    }
+}
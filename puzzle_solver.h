@@ -5,1433 +5,376 @@
 #include <sstream>
 #include <iostream>
 #include <set>
+#include <array>
 #include <queue>
+#include <deque>
 #include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <iterator>
+#include <thread>
+#include <string_view>
 
 #include "puzzle.h"
+#include "puzzle_trace.h"
 
 using namespace std;
 
+struct solver_options
+{
+    size_t probe_depth = 1;       // deepest look-ahead level
+    size_t probe_budget = 65536;  // probes a deep pass may spend at first
+    double time_limit = 0;        // seconds, 0: no limit
+    size_t node_limit = 0;        // DFS nodes, 0: no limit
+    size_t max_solutions = 0;     // stop after this many, 0: all
+    const atomic<bool> *cancel = nullptr; // set from another thread to stop
+    size_t tile_size = 0;         // deduce tile by tile first on larger boards, 0: off
+    double progress_interval = 0; // seconds between progress reports, 0: off
+    solver_trace *trace = nullptr; // records phase spans when set
+    bool count_only = false;      // count solutions, no callback, output or dedupe set
+    string checkpoint_file;       // search state is saved here when set
+    double checkpoint_interval = 0; // seconds between checkpoints, 0: only on request or stop
+    atomic<bool> *checkpoint_now = nullptr; // set from a signal handler, cleared once saved
+    uint64_t seed = 0;            // shuffles the branching order, 0: fixed order
+    size_t restart_nodes = 0;     // nodes per restart unit on a Luby schedule, 0: no restarts;
+                                  // only used with max_solutions 1 or 2
+    bool symmetry = false;        // search one solution per orbit under the clues' symmetries
+};
+
+// One heartbeat of a running solve
+struct solver_progress
+{
+    double elapsed = 0;        // seconds
+    size_t nodes = 0;          // DFS nodes so far
+    double nodes_per_sec = 0;  // since the last report
+    size_t depth = 0;          // DFS depth now
+    double decided = 0;        // share of edges decided on the current board
+    size_t probes = 0;
+    double probes_per_sec = 0; // since the last report
+    size_t solutions = 0;
+};
+
 class puzzle_solver
 {
+    // Times the private rules, see bench.cpp
+    friend class rule_bench;
+
 private:
     /* data */
     puzzle p;
-    unordered_set<string> puzzle_results;
-    ostream *os;
+    unordered_set<string> puzzle_results; // packed edges of each solution
+    size_t solution_count = 0;
+    vector<ostream *> outputs;
+    function<void(puzzle &)> on_solution;
+    function<void(const solver_progress &)> on_progress;
+    solver_options opt;
 
-public:
-    void read_puzzle(istream &is);
-    void set_output(ostream &os)
-    {
-        this->os = &os;
-    }
+    // Look-ahead bookkeeping for one probe level
+    struct probe_level
+    {
+        size_t budget = 0; // probes allowed per pass
+        size_t passes = 0;
+        size_t hits = 0; // passes that decided something
+    };
+    vector<probe_level> levels;
+    size_t probes = 0; // heuristic runs made by probing
 
-    int solve();
-
-private:
-    bool heuristic(puzzle &p, bool head = true);
+    // Budgets
+    chrono::steady_clock::time_point started;
+    size_t nodes = 0; // draw_line calls
+    size_t resumed_nodes = 0; // nodes of the checkpoint resumed, not in the node limit
+    size_t ticks = 0; // budget checks, the clock is read every 16th
+    bool stopped = false;
+    bool enough = false; // max_solutions reached
+    puzzle best; // most decided board seen so far
+    size_t best_decided = 0;
 
-    void ban_edge_around_zero(puzzle &p);
-    void prelink_around_threes(puzzle &p);
+    // Progress
+    size_t depth = 0;            // draw_line calls on the stack
+    puzzle *current = nullptr;   // board of the innermost one
+    chrono::steady_clock::time_point last_report;
+    size_t last_nodes = 0, last_probes = 0;
 
-    void ban_edge_around_one(puzzle &p);
-    void ban_edge_around_two(puzzle &p);
-    void ban_edge_around_three(puzzle &p);
-    void ban_edge_around_point(puzzle &p);
-    void ban_point(puzzle &p);
+    // Cells the rules and probes scan, the whole board unless in a tile
+    struct window
+    {
+        size_t top = 0, left = 0, bottom = 0, right = 0;
+    };
+    window win;
+    bool tile = false; // board is cut out of a larger one
 
-    void link_around_one(puzzle &p);
-    void link_around_two(puzzle &p);
-    void link_around_three(puzzle &p);
-    void link_around_point(puzzle &p);
+    // Search state kept between steps so it can pause at each solution
+    struct search_frame
+    {
+        puzzle p;
+        int start_r, start_c; // where the loop began
+        int r, c;             // line end to go on from
+        int dir = 0;          // next way to try, up, down, left, right ...
+        size_t order = 0;     // ... in the order way_orders()[order]
+        bool fresh;           // no line here yet, tried ways get banned
+        bool root;            // a start point of the empty board scan
+    };
+    vector<search_frame> frames;
+    bool begun = false;
+    bool root_scan = false; // empty board, start points left to try
+    size_t root_row = 0, root_col = 1;
+    bool pulled = false;   // next() was called, solutions are queued for it
+    deque<puzzle> pending; // solutions not pulled yet, symmetric images too
+    size_t reached = 0;   // solutions reached, found before or not
 
-    bool try_draw(puzzle &p);
+    // Restarts
+    bool shuffle = false;
+    mt19937_64 rng;
+    size_t run_limit = 0;  // nodes the current run may reach, 0: no runs
+    bool run_over = false; // stopped by run_limit only
+    puzzle::edge taken{};  // last way tried by step() ...
+    size_t taken_at = 0;   // ... from the frame at this depth
 
-    void DFS(puzzle &p);
-    void go_with_line(puzzle &p,
-                      const int &start_r, const int &start_c,
-                      int src_p_r, int src_p_c,
-                      int dst_p_r, int dst_p_c);
-    void go_without_line(puzzle &p,
-                         const int &start_r, const int &start_c,
-                         const int &src_p_r, const int &src_p_c,
-                         const int &dst_p_r, const int &dst_p_c);
-    void draw_line(puzzle p,
-                   const int &start_r, const int &start_c,
-                   const int &src_p_r, const int &src_p_c,
-                   const int &dst_p_r, const int &dst_p_c);
-};
+    // Symmetries of the clues other than the identity; edge maps the
+    // index of an edge in edges to the index of its image, point maps
+    // row * (cols + 1) + col the same way
+    struct symmetry
+    {
+        vector<uint32_t> edge, point;
+    };
+    vector<puzzle::edge> edges;
+    vector<symmetry> symmetries;
+    chrono::steady_clock::time_point last_checkpoint;
+    bool checkpoint_due = false;
 
-void puzzle_solver::read_puzzle(istream &is)
-{
-    is >> p.cols >> p.rows;
-    // read puzzle
-    for (size_t row = 0; row < p.rows; row++)
+public:
+    enum solve_status
     {
-        string line;
-        is >> line;
-        vector<int> tmp_row;
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            const char c = line[col];
-            switch (c)
-            {
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-                tmp_row.push_back(c - '0');
-                break;
-            default:
-                tmp_row.push_back(-1);
-                break;
-            }
-        }
-        p.lat.push_back(tmp_row);
-    }
-    // init connect state table
-    for (size_t row = 0; row < p.rows + 1; row++)
+        DONE,    // search finished
+        INVALID, // contradiction before any search
+        LIMIT,    // stopped by the time or node limit
+        BAD_INPUT // puzzle text did not parse
+    };
+
+    void read_puzzle(istream &is);
+    bool read_puzzle(string_view text);
+    void set_puzzle(const puzzle &p)
     {
-        vector<puzzle::edge_state> tmp_row;
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            tmp_row.push_back(puzzle::NOT);
-        }
-        p.hrz.push_back(tmp_row);
+        this->p = p;
     }
-    for (size_t row = 0; row < p.rows; row++)
+    // Rendered solutions are written to every output
+    void add_output(ostream &os)
     {
-        vector<puzzle::edge_state> tmp_row;
-        for (size_t col = 0; col < p.cols + 1; col++)
-        {
-            tmp_row.push_back(puzzle::NOT);
-        }
-        p.vrt.push_back(tmp_row);
+        outputs.push_back(&os);
     }
-    // init banned point
-    for (size_t row = 0; row <= p.rows; row++)
+    void set_callback(function<void(puzzle &)> on_solution)
     {
-        vector<bool> tmp_row;
-        for (size_t col = 0; col <= p.cols; col++)
-        {
-            tmp_row.push_back(false);
-        }
-        p.banned_point.push_back(tmp_row);
+        this->on_solution = on_solution;
     }
-}
-
-int puzzle_solver::solve()
-{
-    ban_edge_around_zero(p);
-    prelink_around_threes(p);
-    if (heuristic(p) == false)
+    // Progress reports go here instead of stderr
+    void set_progress_callback(function<void(const solver_progress &)> on_progress)
     {
-        return -1;
+        this->on_progress = on_progress;
     }
-    // Heuristic done
-    if (p.is_fin() && p.is_correct())
+    void set_options(const solver_options &opt)
     {
-        // Print solution
-        const auto result = p.to_string();
-        if (puzzle_results.find(result) == puzzle_results.end())
-        {
-            puzzle_results.insert(result);
-            cout << result;
-            *os << result;
-        }
+        this->opt = opt;
     }
-    DFS(p);
-    return puzzle_results.size();
-}
 
-bool puzzle_solver::heuristic(puzzle &p, bool ahead)
-{
-    string last_step = p.to_string();
-    string curr_step;
-    while (true)
-    {
-        ban_edge_around_one(p);
-        ban_edge_around_two(p);
-        ban_edge_around_three(p);
-        ban_edge_around_point(p);
-        ban_point(p);
-        link_around_point(p);
-        link_around_three(p);
-        link_around_two(p);
-        link_around_one(p);
-        if (!p.is_correct())
+    int solve();
+
+    // Pulls solutions one at a time, the search runs only as far as the
+    // next one and can be left at any point:
+    //     for (puzzle &s : ps.solutions()) ...
+    class solution_iterator
+    {
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type = puzzle;
+        using difference_type = ptrdiff_t;
+        using pointer = puzzle *;
+        using reference = puzzle &;
+
+        solution_iterator(puzzle_solver *s = nullptr) : s(s)
         {
-            return false;
+            ++*this;
         }
-        curr_step = p.to_string();
-        // run out of normal methods
-        if (last_step.compare(curr_step) == 0)
+        puzzle &operator*()
         {
-            break;
+            return cur;
         }
-        else // normal method make sense
+        puzzle *operator->()
         {
-            last_step = curr_step;
+            return &cur;
         }
-    }
-    // look ahead
-    while (ahead == true)
-    {
-        if (try_draw(p) == false)
+        solution_iterator &operator++()
         {
-            return false;
+            if (s != nullptr && !s->next(cur))
+                s = nullptr;
+            return *this;
         }
-        else
+        bool operator==(const solution_iterator &o) const
         {
-            // look ahead make sense
-            // try normal methods again
-            curr_step = p.to_string();
-            if (last_step.compare(curr_step) == 0)
-            {
-                break;
-            }
-            last_step = curr_step;
+            return s == o.s;
         }
-    }
-    // look head not useful
-    // return to DFS
-    return true;
-}
-
-void puzzle_solver::ban_edge_around_zero(puzzle &p)
-{
-    /**
-     * . b .
-     * b 0 b
-     * . b .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
+        bool operator!=(const solution_iterator &o) const
         {
-            if (p.lat[row][col] == 0)
-            {
-                p.hrz[row][col] = puzzle::BAN;
-                p.hrz[row + 1][col] = puzzle::BAN;
-                p.vrt[row][col] = puzzle::BAN;
-                p.vrt[row][col + 1] = puzzle::BAN;
-            }
+            return s != o.s;
         }
-    }
-}
 
-void puzzle_solver::prelink_around_threes(puzzle &p)
-{
-    /**
-     *   . l .
-     *     3
-     * b . l . b
-     *     3
-     *   . l .
-     */
-    for (size_t row = 0; row < p.rows - 1; row++)
+    private:
+        puzzle_solver *s;
+        puzzle cur;
+    };
+    struct solution_range
     {
-        for (size_t col = 0; col < p.cols; col++)
+        puzzle_solver *s;
+        solution_iterator begin()
         {
-            if (p.lat[row][col] == 3 && p.lat[row + 1][col] == 3)
-            {
-                p.hrz[row][col] = puzzle::LINKED;
-                p.hrz[row + 1][col] = puzzle::LINKED;
-                p.hrz[row + 2][col] = puzzle::LINKED;
-                if (p.point_can_left(row + 1, col))
-                    p.hrz[row + 1][col - 1] = puzzle::BAN;
-                if (p.point_can_right(row + 1, col + 1))
-                    p.hrz[row + 1][col + 1] = puzzle::BAN;
-            }
+            return solution_iterator(s);
         }
-    }
-    /**
-     *     b
-     * .   .   .
-     * l 3 l 3 l
-     * .   .   .
-     *     b
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols - 1; col++)
-        {
-            if (p.lat[row][col] == 3 && p.lat[row][col + 1] == 3)
-            {
-                p.vrt[row][col] = puzzle::LINKED;
-                p.vrt[row][col + 1] = puzzle::LINKED;
-                p.vrt[row][col + 2] = puzzle::LINKED;
-                if (p.point_can_up(row, col + 1))
-                    p.vrt[row - 1][col + 1] = puzzle::BAN;
-                if (p.point_can_down(row + 1, col + 1))
-                    p.vrt[row + 1][col + 1] = puzzle::BAN;
-            }
-        }
-    }
-    /**
-     *   b
-     * b . l .   .
-     *   l 3
-     *   .   .   .
-     *         3 l
-     *   .   . l . b
-     *           b
-     */
-    for (size_t row = 0; row < p.rows - 1; row++)
-    {
-        for (size_t col = 0; col < p.cols - 1; col++)
+        solution_iterator end()
         {
-            if (p.lat[row][col] == 3 && p.lat[row + 1][col + 1] == 3)
-            {
-                p.hrz[row][col] = puzzle::LINKED;
-                p.vrt[row][col] = puzzle::LINKED;
-                p.hrz[row + 2][col + 1] = puzzle::LINKED;
-                p.vrt[row + 1][col + 2] = puzzle::LINKED;
-                if (p.point_can_up(row, col))
-                    p.vrt[row - 1][col] = puzzle::BAN;
-                if (p.point_can_left(row, col))
-                    p.hrz[row][col - 1] = puzzle::BAN;
-                if (p.point_can_down(row + 2, col + 2))
-                    p.vrt[row + 2][col + 2] = puzzle::BAN;
-                if (p.point_can_right(row + 2, col + 2))
-                    p.hrz[row + 2][col + 2] = puzzle::BAN;
-            }
+            return solution_iterator();
         }
-    }
-    /**
-     *           b
-     *   .   . l . b
-     *         3 l
-     *   .   .   .
-     *   l 3
-     * b . l .   .
-     *   b
-     */
-    for (size_t row = 0; row < p.rows - 1; row++)
+    };
+    solution_range solutions()
     {
-        for (size_t col = 0; col < p.cols - 1; col++)
-        {
-            if (p.lat[row][col + 1] == 3 && p.lat[row + 1][col] == 3)
-            {
-                p.hrz[row][col + 1] = puzzle::LINKED;
-                p.vrt[row][col + 2] = puzzle::LINKED;
-                p.hrz[row + 2][col] = puzzle::LINKED;
-                p.vrt[row + 1][col] = puzzle::LINKED;
-                if (p.point_can_up(row, col + 2))
-                    p.vrt[row - 1][col + 2] = puzzle::BAN;
-                if (p.point_can_right(row, col + 2))
-                    p.hrz[row][col + 2] = puzzle::BAN;
-                if (p.point_can_down(row + 2, col))
-                    p.vrt[row + 2][col] = puzzle::BAN;
-                if (p.point_can_left(row + 2, col))
-                    p.hrz[row + 2][col - 1] = puzzle::BAN;
-            }
-        }
+        return {this};
     }
-}
+    // Searches on to the next solution, false when there are no more or a
+    // limit was hit; the first call deduces and sets up the search
+    bool next(puzzle &out);
 
-void puzzle_solver::ban_edge_around_one(puzzle &p)
-{
-    /**
-     *   x
-     * x . b .
-     *   b 1
-     *   .   .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 1 && p.get_lat_banned_edge(row, col) < 2)
-            {
-                if (!p.point_can_up(row, col) &&
-                    !p.point_can_left(row, col))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                if (!p.point_can_up(row, col + 1) &&
-                    !p.point_can_right(row, col + 1))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                if (!p.point_can_down(row + 1, col) &&
-                    !p.point_can_left(row + 1, col))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                if (!p.point_can_down(row + 1, col + 1) &&
-                    !p.point_can_right(row + 1, col + 1))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-            }
-        }
-    }
-    /**
-     * . b .
-     * b 1 |
-     * . b .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 1 && p.get_lat_banned_edge(row, col) != 3)
-            {
-                if (p.hrz_has_edge(row, col))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.hrz_has_edge(row + 1, col))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.vrt_has_edge(row, col))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.vrt_has_edge(row, col + 1))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-            }
-        }
-    }
-    /**
-     *   x
-     * - .   .
-     *     1 b
-     *   . b .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 1 && p.get_lat_banned_edge(row, col) < 2)
-            {
-                if ((p.point_has_edge_up(row, col) || p.point_has_edge_left(row, col)) &&
-                    (!p.point_can_up(row, col) || !p.point_can_left(row, col)))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                if ((p.point_has_edge_up(row, col + 1) || p.point_has_edge_right(row, col + 1)) &&
-                    (!p.point_can_up(row, col + 1) || !p.point_can_right(row, col + 1)))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                if ((p.point_has_edge_down(row + 1, col) || p.point_has_edge_left(row + 1, col)) &&
-                    (!p.point_can_down(row + 1, col) || !p.point_can_left(row + 1, col)))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                if ((p.point_has_edge_down(row + 1, col + 1) || p.point_has_edge_right(row + 1, col + 1)) &&
-                    (!p.point_can_down(row + 1, col + 1) || !p.point_can_right(row + 1, col + 1)))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-            }
-        }
-    }
-}
+    // Everything the search needs to go on: the stack of frames, the root
+    // board, counters and the solutions found so far
+    void save_checkpoint(ostream &os);
+    // Loads a checkpoint of the puzzle set before, next() or solve() then
+    // go on from there; false if it is damaged or for another puzzle
+    bool resume(istream &is);
+    // Branches breadth first until the search is cut into up to n pieces
+    // that share nothing, each saved like a checkpoint; resume() solves
+    // one. Solutions met on the way are reported as usual
+    vector<string> split(size_t n);
 
-void puzzle_solver::ban_edge_around_two(puzzle &p)
-{
-    /**
-     * . - .
-     * b 2 |
-     * . b .
-     */
-    for (size_t row = 0; row < p.rows; row++)
+    // What the clues force on board: zeros, adjacent threes, then the rules
+    // and probes; false on a contradiction
+    bool deduce(puzzle &board);
+    // Settles board again after one edge changed, scanning only the cells
+    // near it and widening that while the changes reach its sides
+    bool propagate(puzzle &board, const puzzle::edge &changed);
+    size_t get_cols()
     {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 2 && p.get_lat_banned_edge(row, col) != 2)
-            {
-                if (p.hrz_has_edge(row, col) &&
-                    p.vrt_has_edge(row, col))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.hrz_has_edge(row, col) &&
-                         p.hrz_has_edge(row + 1, col))
-                {
-                    p.vrt[row][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.hrz_has_edge(row, col) &&
-                         p.vrt_has_edge(row, col + 1))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                else if (p.hrz_has_edge(row + 1, col) &&
-                         p.vrt_has_edge(row, col))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.hrz_has_edge(row + 1, col) &&
-                         p.vrt_has_edge(row, col + 1))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                else if (p.vrt_has_edge(row, col) &&
-                         p.vrt_has_edge(row, col + 1))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                }
-            }
-        }
+        return p.cols;
     }
-}
-
-void puzzle_solver::ban_edge_around_three(puzzle &p)
-{
-    /**
-     * . - .
-     * | 3 |
-     * . b .
-     */
-    for (size_t row = 0; row < p.rows; row++)
+    size_t get_rows()
     {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 3 && p.get_lat_banned_edge(row, col) != 1)
-            {
-                if (p.hrz_has_edge(row, col) &&
-                    p.hrz_has_edge(row + 1, col) &&
-                    p.vrt_has_edge(row, col))
-                {
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                else if (p.hrz_has_edge(row, col) &&
-                         p.hrz_has_edge(row + 1, col) &&
-                         p.vrt_has_edge(row, col + 1))
-                {
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                else if (p.vrt_has_edge(row, col) &&
-                         p.vrt_has_edge(row, col + 1) &&
-                         p.hrz_has_edge(row, col))
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                }
-                else if (p.vrt_has_edge(row, col) &&
-                         p.vrt_has_edge(row, col + 1) &&
-                         p.hrz_has_edge(row + 1, col))
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                }
-            }
-        }
+        return p.rows;
     }
-}
-
-void puzzle_solver::ban_edge_around_point(puzzle &p)
-{
-    /**
-     *   x
-     * x . x
-     *   b
-     */
-    for (size_t row = 0; row <= p.rows; row++)
+    size_t get_solution_count()
     {
-        for (size_t col = 0; col <= p.cols; col++)
-        {
-            if (!p.point_can_up(row, col) &&
-                !p.point_can_down(row, col) &&
-                !p.point_can_left(row, col) &&
-                p.point_can_right(row, col))
-            {
-                p.hrz[row][col] = puzzle::BAN;
-            }
-            else if (!p.point_can_up(row, col) &&
-                     !p.point_can_down(row, col) &&
-                     p.point_can_left(row, col) &&
-                     !p.point_can_right(row, col))
-            {
-                p.hrz[row][col - 1] = puzzle::BAN;
-            }
-            else if (!p.point_can_up(row, col) &&
-                     p.point_can_down(row, col) &&
-                     !p.point_can_left(row, col) &&
-                     !p.point_can_right(row, col))
-            {
-                p.vrt[row][col] = puzzle::BAN;
-            }
-            else if (p.point_can_up(row, col) &&
-                     !p.point_can_down(row, col) &&
-                     !p.point_can_left(row, col) &&
-                     !p.point_can_right(row, col))
-            {
-                p.vrt[row - 1][col] = puzzle::BAN;
-            }
-        }
+        return solution_count;
     }
-    /**
-     *   b
-     * - . b
-     *   |
-     */
-    for (size_t row = 0; row <= p.rows; row++)
+    solve_status get_status()
     {
-        for (size_t col = 0; col <= p.cols; col++)
-        {
-            if (p.point_has_edge_up(row, col) &&
-                p.point_has_edge_down(row, col))
-            {
-                if (p.point_can_left(row, col))
-                    p.hrz[row][col - 1] = puzzle::BAN;
-                if (p.point_can_right(row, col))
-                    p.hrz[row][col] = puzzle::BAN;
-            }
-            else if (p.point_has_edge_left(row, col) &&
-                     p.point_has_edge_right(row, col))
-            {
-                if (p.point_can_up(row, col))
-                    p.vrt[row - 1][col] = puzzle::BAN;
-                if (p.point_can_down(row, col))
-                    p.vrt[row][col] = puzzle::BAN;
-            }
-            else if (p.point_has_edge_up(row, col) &&
-                     p.point_has_edge_left(row, col))
-            {
-                if (p.point_can_right(row, col))
-                    p.hrz[row][col] = puzzle::BAN;
-                if (p.point_can_down(row, col))
-                    p.vrt[row][col] = puzzle::BAN;
-            }
-            else if (p.point_has_edge_up(row, col) &&
-                     p.point_has_edge_right(row, col))
-            {
-                if (p.point_can_left(row, col))
-                    p.hrz[row][col - 1] = puzzle::BAN;
-                if (p.point_can_down(row, col))
-                    p.vrt[row][col] = puzzle::BAN;
-            }
-            else if (p.point_has_edge_down(row, col) &&
-                     p.point_has_edge_left(row, col))
-            {
-                if (p.point_can_up(row, col))
-                    p.vrt[row - 1][col] = puzzle::BAN;
-                if (p.point_can_right(row, col))
-                    p.hrz[row][col] = puzzle::BAN;
-            }
-            else if (p.point_has_edge_down(row, col) &&
-                     p.point_has_edge_right(row, col))
-            {
-                if (p.point_can_up(row, col))
-                    p.vrt[row - 1][col] = puzzle::BAN;
-                if (p.point_can_left(row, col))
-                    p.hrz[row][col - 1] = puzzle::BAN;
-            }
-        }
+        if (stopped)
+            return LIMIT;
+        return solution_count == 0 ? INVALID : DONE;
     }
-}
-
-void puzzle_solver::ban_point(puzzle &p)
-{
-    /**
-     *   x
-     * x b x
-     *   x
-     */
-    for (size_t row = 0; row <= p.rows; row++)
+    // Most deduced board, worth printing when a limit was hit
+    puzzle get_partial()
     {
-        for (size_t col = 0; col <= p.cols; col++)
-        {
-            if (!p.point_can_up(row, col) &&
-                !p.point_can_down(row, col) &&
-                !p.point_can_left(row, col) &&
-                !p.point_can_right(row, col))
-            {
-                p.banned_point[row][col] = true;
-            }
-        }
+        return best;
     }
-}
 
-void puzzle_solver::link_around_one(puzzle &p)
-{
-    /**
-     * . x .
-     * x 1 x
-     * . l .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 1 &&
-                !p.complete_lat(row, col) &&
-                p.get_lat_banned_edge(row, col) == 3)
-            {
-                if (p.hrz[row][col] != puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                }
-                else if (p.hrz[row + 1][col] != puzzle::BAN)
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                }
-                else if (p.vrt[row][col] != puzzle::BAN)
-                {
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-                else if (p.vrt[row][col + 1] != puzzle::BAN)
-                {
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-            }
-        }
-    }
-}
+private:
+    void report(puzzle &p);
+    void found(puzzle &p);
+    void find_symmetries();
+    bool lex_leader(puzzle &p, bool solved);
+    bool out_of_budget();
+    void progress(chrono::steady_clock::time_point now);
+    void keep_best(puzzle &p);
 
-void puzzle_solver::link_around_two(puzzle &p)
-{
-    /**
-     * . l .
-     * x 2 x
-     * . l .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 2 &&
-                !p.complete_lat(row, col) &&
-                p.get_lat_banned_edge(row, col) == 2)
-            {
-                if (p.hrz[row][col] == puzzle::BAN &&
-                    p.hrz[row + 1][col] == puzzle::BAN)
-                {
-                    p.vrt[row][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                else if (p.vrt[row][col] == puzzle::BAN &&
-                         p.vrt[row][col + 1] == puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                }
-                else if (p.hrz[row][col] == puzzle::BAN &&
-                         p.vrt[row][col] == puzzle::BAN)
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                else if (p.hrz[row][col] == puzzle::BAN &&
-                         p.vrt[row][col + 1] == puzzle::BAN)
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-                else if (p.hrz[row + 1][col] == puzzle::BAN &&
-                         p.vrt[row][col] == puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                else if (p.hrz[row + 1][col] == puzzle::BAN &&
-                         p.vrt[row][col + 1] == puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-            }
-        }
-    }
-    /**
-     *       ?
-     *   .   . ?
-     *     2  
-     * ? .   . x
-     *   ?   x
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 2 &&
-                !p.complete_lat(row, col))
-            {
-                if (!p.point_can_up(row, col) && !p.point_can_left(row, col))
-                {
-                    if (!p.point_can_left(row + 1, col) && p.point_can_down(row + 1, col))
-                        p.vrt[row + 1][col] = puzzle::LINKED;
-                    if (p.point_can_left(row + 1, col) && !p.point_can_down(row + 1, col))
-                        p.hrz[row + 1][col - 1] = puzzle::LINKED;
-                    if (!p.point_can_right(row, col + 1) && p.point_can_up(row, col + 1))
-                        p.vrt[row - 1][col + 1] = puzzle::LINKED;
-                    if (p.point_can_right(row, col + 1) && !p.point_can_up(row, col + 1))
-                        p.hrz[row][col + 1] = puzzle::LINKED;
-                }
-                if (!p.point_can_up(row, col + 1) && !p.point_can_right(row, col + 1))
-                {
-                    if (!p.point_can_left(row, col) && p.point_can_up(row, col))
-                        p.vrt[row - 1][col] = puzzle::LINKED;
-                    if (p.point_can_left(row, col) && !p.point_can_up(row, col))
-                        p.hrz[row][col - 1] = puzzle::LINKED;
-                    if (!p.point_can_right(row + 1, col + 1) && p.point_can_down(row + 1, col + 1))
-                        p.vrt[row + 1][col + 1] = puzzle::LINKED;
-                    if (p.point_can_right(row + 1, col + 1) && !p.point_can_down(row + 1, col + 1))
-                        p.hrz[row + 1][col + 1] = puzzle::LINKED;
-                }
-                if (!p.point_can_down(row + 1, col + 1) && !p.point_can_right(row + 1, col + 1))
-                {
-                    if (!p.point_can_right(row, col + 1) && p.point_can_up(row, col + 1))
-                        p.vrt[row - 1][col + 1] = puzzle::LINKED;
-                    if (p.point_can_right(row, col + 1) && !p.point_can_up(row, col + 1))
-                        p.hrz[row][col + 1] = puzzle::LINKED;
-                    if (!p.point_can_left(row + 1, col) && p.point_can_down(row + 1, col))
-                        p.vrt[row + 1][col] = puzzle::LINKED;
-                    if (p.point_can_left(row + 1, col) && !p.point_can_down(row + 1, col))
-                        p.hrz[row + 1][col - 1] = puzzle::LINKED;
-                }
-                if (!p.point_can_down(row + 1, col) && !p.point_can_left(row + 1, col))
-                {
-                    if (!p.point_can_left(row, col) && p.point_can_up(row, col))
-                        p.vrt[row - 1][col] = puzzle::LINKED;
-                    if (p.point_can_left(row, col) && !p.point_can_up(row, col))
-                        p.hrz[row][col - 1] = puzzle::LINKED;
-                    if (!p.point_can_right(row + 1, col + 1) && p.point_can_down(row + 1, col + 1))
-                        p.vrt[row + 1][col + 1] = puzzle::LINKED;
-                    if (p.point_can_right(row + 1, col + 1) && !p.point_can_down(row + 1, col + 1))
-                        p.hrz[row + 1][col + 1] = puzzle::LINKED;
-                }
-            }
-        }
-    }
-}
+    bool heuristic(puzzle &p, size_t depth);
+    bool is_correct(puzzle &p);
 
-void puzzle_solver::link_around_three(puzzle &p)
-{
-    /**
-     * . l .
-     * x 3 l
-     * . l .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 3 &&
-                !p.complete_lat(row, col) &&
-                p.get_lat_banned_edge(row, col) == 1)
-            {
-                if (p.hrz[row][col] == puzzle::BAN)
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                else if (p.hrz[row + 1][col] == puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                else if (p.vrt[row][col] == puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                else if (p.vrt[row][col + 1] == puzzle::BAN)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-            }
-        }
-    }
-    /**
-     *   x
-     * x . l .
-     *   l 3
-     *   .   .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 3 && !p.complete_lat(row, col))
-            {
-                if (!p.point_can_up(row, col) &&
-                    !p.point_can_left(row, col))
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-                if (!p.point_can_up(row, col + 1) &&
-                    !p.point_can_right(row, col + 1))
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                if (!p.point_can_down(row + 1, col) &&
-                    !p.point_can_left(row + 1, col))
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-                if (!p.point_can_down(row + 1, col + 1) &&
-                    !p.point_can_right(row + 1, col + 1))
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-            }
-        }
-    }
-    /**
-     * - .   .
-     *     3 l
-     *   . l .
-     */
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 0; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 3 && !p.complete_lat(row, col))
-            {
-                if (p.point_has_edge_up(row, col) ||
-                    p.point_has_edge_left(row, col))
-                {
-                    if (p.hrz[row + 1][col] == puzzle::NOT &&
-                        p.vrt[row][col + 1] == puzzle::NOT)
-                    {
-                        p.hrz[row + 1][col] = puzzle::LINKED;
-                        p.vrt[row][col + 1] = puzzle::LINKED;
-                    }
-                }
-                if (p.point_has_edge_up(row, col + 1) ||
-                    p.point_has_edge_right(row, col + 1))
-                {
-                    if (p.hrz[row + 1][col] == puzzle::NOT &&
-                        p.vrt[row][col] == puzzle::NOT)
-                    {
-                        p.hrz[row + 1][col] = puzzle::LINKED;
-                        p.vrt[row][col] = puzzle::LINKED;
-                    }
-                }
-                if (p.point_has_edge_down(row + 1, col) ||
-                    p.point_has_edge_left(row + 1, col))
-                {
-                    if (p.hrz[row][col] == puzzle::NOT &&
-                        p.vrt[row][col + 1] == puzzle::NOT)
-                    {
-                        p.hrz[row][col] = puzzle::LINKED;
-                        p.vrt[row][col + 1] = puzzle::LINKED;
-                    }
-                }
-                if (p.point_has_edge_down(row + 1, col + 1) ||
-                    p.point_has_edge_right(row + 1, col + 1))
-                {
-                    if (p.hrz[row][col] == puzzle::NOT &&
-                        p.vrt[row][col] == puzzle::NOT)
-                    {
-                        p.hrz[row][col] = puzzle::LINKED;
-                        p.vrt[row][col] = puzzle::LINKED;
-                    }
-                }
-            }
-        }
-    }
-}
+    bool solve_tiles(puzzle &p);
+    bool solve_tile(const puzzle &p, const window &w, puzzle &out);
 
-void puzzle_solver::link_around_point(puzzle &p)
-{
-    /**
-     *   x
-     * l . x
-     *   |
-     */
-    for (size_t row = 0; row <= p.rows; row++)
-    {
-        for (size_t col = 0; col <= p.cols; col++)
-        {
-            if (p.get_conn(row, col) == 1)
-            {
-                if (p.point_can_up(row, col) &&
-                    p.point_can_down(row, col) &&
-                    !p.point_can_left(row, col) &&
-                    !p.point_can_right(row, col))
-                {
-                    p.vrt[row - 1][col] = puzzle::LINKED;
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-                else if (p.point_can_up(row, col) &&
-                         !p.point_can_down(row, col) &&
-                         p.point_can_left(row, col) &&
-                         !p.point_can_right(row, col))
-                {
-                    p.vrt[row - 1][col] = puzzle::LINKED;
-                    p.hrz[row][col - 1] = puzzle::LINKED;
-                }
-                else if (p.point_can_up(row, col) &&
-                         !p.point_can_down(row, col) &&
-                         !p.point_can_left(row, col) &&
-                         p.point_can_right(row, col))
-                {
-                    p.vrt[row - 1][col] = puzzle::LINKED;
-                    p.hrz[row][col] = puzzle::LINKED;
-                }
-                else if (!p.point_can_up(row, col) &&
-                         p.point_can_down(row, col) &&
-                         p.point_can_left(row, col) &&
-                         !p.point_can_right(row, col))
-                {
-                    p.vrt[row][col] = puzzle::LINKED;
-                    p.hrz[row][col - 1] = puzzle::LINKED;
-                }
-                else if (!p.point_can_up(row, col) &&
-                         p.point_can_down(row, col) &&
-                         !p.point_can_left(row, col) &&
-                         p.point_can_right(row, col))
-                {
-                    p.vrt[row][col] = puzzle::LINKED;
-                    p.hrz[row][col] = puzzle::LINKED;
-                }
-                else if (!p.point_can_up(row, col) &&
-                         !p.point_can_down(row, col) &&
-                         p.point_can_left(row, col) &&
-                         p.point_can_right(row, col))
-                {
-                    p.hrz[row][col - 1] = puzzle::LINKED;
-                    p.hrz[row][col] = puzzle::LINKED;
-                }
-            }
-        }
-    }
-}
+    void ban_edge_around_zero(puzzle &p);
+    void prelink_around_threes(puzzle &p);
 
-bool puzzle_solver::try_draw(puzzle &p)
-{
-    // horizontal
-    for (size_t row = 0; row <= p.rows; row++)
-    {
-        for (size_t col = 1; col < p.cols; col++)
-        {
-            if (p.hrz[row][col] == puzzle::NOT)
-            {
-                puzzle np = p;
-                bool no_link = false;
-                bool no_ban = false;
-                np.hrz[row][col] = puzzle::BAN;
-                if (heuristic(np, false) == false)
-                {
-                    no_ban = true;
-                }
-                np = p;
-                np.hrz[row][col] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    no_link = true;
-                }
-                if (no_link && no_ban)
-                {
-                    return false;
-                }
-                else if (no_link)
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                    heuristic(p, false);
-                }
-                else if (no_ban)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                    heuristic(p, false);
-                }
-            }
-        }
-    }
-    // vertical
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 1; col <= p.cols; col++)
-        {
-            if (p.vrt[row][col] == puzzle::NOT)
-            {
-                puzzle np = p;
-                bool no_link = false;
-                bool no_ban = false;
-                np.vrt[row][col] = puzzle::BAN;
-                if (heuristic(np, false) == false)
-                {
-                    no_ban = true;
-                }
-                np = p;
-                np.vrt[row][col] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    no_link = true;
-                }
-                if (no_link && no_ban)
-                {
-                    return false;
-                }
-                else if (no_link)
-                {
-                    p.vrt[row][col] = puzzle::BAN;
-                    heuristic(p, false);
-                }
-                else if (no_ban)
-                {
-                    p.vrt[row][col] = puzzle::LINKED;
-                    heuristic(p, false);
-                }
-            }
-        }
-    }
-    // around two
-    for (size_t row = 0; row < p.rows; row++)
-    {
-        for (size_t col = 1; col < p.cols; col++)
-        {
-            if (p.lat[row][col] == 2 &&
-                p.lat_edge(row, col) == 0 &&
-                p.get_lat_banned_edge(row, col) == 0)
-            {
-                puzzle np = p;
-                int not_allow[6][4] = {0};
-                np.hrz[row][col] = puzzle::LINKED;
-                np.vrt[row][col] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    not_allow[0][0] = -1;
-                    not_allow[0][1] = -1;
-                    not_allow[0][2] = 1;
-                    not_allow[0][3] = 1;
-                }
-                np = p;
-                np.hrz[row][col] = puzzle::LINKED;
-                np.vrt[row][col + 1] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    not_allow[1][0] = 1;
-                    not_allow[1][1] = -1;
-                    not_allow[1][2] = -1;
-                    not_allow[1][3] = 1;
-                }
-                np = p;
-                np.hrz[row + 1][col] = puzzle::LINKED;
-                np.vrt[row][col + 1] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    not_allow[2][0] = 1;
-                    not_allow[2][1] = 1;
-                    not_allow[2][2] = -1;
-                    not_allow[2][3] = -1;
-                }
-                np = p;
-                np.hrz[row + 1][col] = puzzle::LINKED;
-                np.vrt[row][col] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    not_allow[3][0] = -1;
-                    not_allow[3][1] = 1;
-                    not_allow[3][2] = 1;
-                    not_allow[3][3] = -1;
-                }
-                np = p;
-                np.hrz[row][col] = puzzle::LINKED;
-                np.hrz[row + 1][col] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    not_allow[4][0] = 1;
-                    not_allow[4][1] = -1;
-                    not_allow[4][2] = 1;
-                    not_allow[4][3] = -1;
-                }
-                np = p;
-                np.vrt[row][col] = puzzle::LINKED;
-                np.vrt[row][col + 1] = puzzle::LINKED;
-                if (heuristic(np, false) == false)
-                {
-                    not_allow[5][0] = -1;
-                    not_allow[5][1] = 1;
-                    not_allow[5][2] = -1;
-                    not_allow[5][3] = 1;
-                }
-                int no_cnt[4] = {0};
-                int link_cnt[4] = {0};
-                for (size_t i = 0; i < 6; i++)
-                {
-                    for (size_t j = 0; j < 4; j++)
-                    {
-                        no_cnt[j] += (not_allow[i][j] == -1 ? 1 : 0);
-                        link_cnt[j] += (not_allow[i][j] == 1 ? 1 : 0);
-                    }
-                }
-                if (no_cnt[0] == 3)
-                {
-                    p.vrt[row][col] = puzzle::BAN;
-                }
-                if (no_cnt[1] == 3)
-                {
-                    p.hrz[row][col] = puzzle::BAN;
-                }
-                if (no_cnt[2] == 3)
-                {
-                    p.vrt[row][col + 1] = puzzle::BAN;
-                }
-                if (no_cnt[3] == 3)
-                {
-                    p.hrz[row + 1][col] = puzzle::BAN;
-                }
-                if (link_cnt[0] == 3)
-                {
-                    p.vrt[row][col] = puzzle::LINKED;
-                }
-                if (link_cnt[1] == 3)
-                {
-                    p.hrz[row][col] = puzzle::LINKED;
-                }
-                if (link_cnt[2] == 3)
-                {
-                    p.vrt[row][col + 1] = puzzle::LINKED;
-                }
-                if (link_cnt[3] == 3)
-                {
-                    p.hrz[row + 1][col] = puzzle::LINKED;
-                }
-                heuristic(p, false);
-            }
-        }
-    }
-    return true;
-}
+    void ban_edge_around_one(puzzle &p);
+    void ban_edge_around_two(puzzle &p);
+    void ban_edge_around_three(puzzle &p);
+    void ban_edge_around_point(puzzle &p);
+    void ban_point(puzzle &p);
 
-void puzzle_solver::DFS(puzzle &p)
-{
-    // Start with one line
-    for (size_t row = 0; row <= p.rows; row++)
-    {
-        for (size_t col = 1; col <= p.cols; col++)
-        {
-            if (!p.banned_point[row][col] && p.get_conn(row, col) == 1)
-            {
-                go_without_line(p, row, col, row, col, row, col);
-                return;
-            }
-        }
-    }
-    // No line on this map
-    // For every points find all solutions
-    for (size_t row = 0; row <= p.rows; row++)
-    {
-        // Optimized
-        for (size_t col = 1; col <= p.cols; col += 2)
-        {
-            go_without_line(p, row, col, row, col, row, col);
-            // set point banned
-            p.banned_point[row][col - 1] = true;
-            p.banned_point[row][col] = true;
-            if (col + 1 == p.cols)
-                p.banned_point[row][col + 1] = true;
-        }
-    }
-}
+    void link_around_one(puzzle &p);
+    void link_around_two(puzzle &p);
+    void link_around_three(puzzle &p);
+    void link_around_point(puzzle &p);
+    bool colour_cells(puzzle &p, size_t &decided);
+    bool ban_edge_off_block(puzzle &p, size_t &decided);
 
-void puzzle_solver::go_with_line(puzzle &p,
-                                 const int &start_r, const int &start_c,
-                                 int src_p_r, int src_p_c,
-                                 int dst_p_r, int dst_p_c)
-{
-    while (p.get_conn(dst_p_r, dst_p_c) == 2) // with line
-    {
-        // If solved
-        if (dst_p_r == start_r && dst_p_c == start_c)
-        {
-            // Do final check
-            if (p.is_fin() && p.is_correct())
-            {
-                // Print solution
-                const auto result = p.to_string();
-                if (puzzle_results.find(result) == puzzle_results.end())
-                {
-                    puzzle_results.insert(result);
-                    cout << result;
-                    *os << result;
-                }
-            }
-            return;
-        }
-        // one step
-        if (p.point_can_up(dst_p_r, dst_p_c) &&
-            p.vrt_has_edge(dst_p_r - 1, dst_p_c) &&
-            dst_p_r - 1 != src_p_r)
-        {
-            src_p_r = dst_p_r;
-            src_p_c = dst_p_c;
-            --dst_p_r;
-        }
-        else if (p.point_can_down(dst_p_r, dst_p_c) &&
-                 p.vrt_has_edge(dst_p_r, dst_p_c) &&
-                 dst_p_r + 1 != src_p_r)
-        {
-            src_p_r = dst_p_r;
-            src_p_c = dst_p_c;
-            ++dst_p_r;
-        }
-        else if (p.point_can_left(dst_p_r, dst_p_c) &&
-                 p.hrz_has_edge(dst_p_r, dst_p_c - 1) &&
-                 dst_p_c - 1 != src_p_c)
-        {
-            src_p_r = dst_p_r;
-            src_p_c = dst_p_c;
-            --dst_p_c;
-        }
-        else if (p.point_can_right(dst_p_r, dst_p_c) &&
-                 p.hrz_has_edge(dst_p_r, dst_p_c) &&
-                 dst_p_c + 1 != src_p_c)
-        {
-            src_p_r = dst_p_r;
-            src_p_c = dst_p_c;
-            ++dst_p_c;
-        }
-    }
-    // without line
-    go_without_line(p,
-                    start_r, start_c,
-                    src_p_r, src_p_c,
-                    dst_p_r, dst_p_c);
-}
+    // Where a probe's propagation reached, in cells, and when it ran
+    struct probe_reach
+    {
+        size_t stamp = 0; // 0: never probed
+        int top, left, bottom, right;
+        size_t tries = 0; // heuristic runs spent probing here
+        size_t hits = 0;  // probes here that decided an edge
+    };
+    // Change tracking shared by the look-ahead passes of one heuristic
+    struct probe_memo
+    {
+        size_t clock = 1;
+        puzzle seen;                    // board at the last sync
+        vector<vector<size_t>> changed; // cell -> clock of its last change
+        vector<vector<probe_reach>> hrz, vrt, two, end;
+    };
+    void memo_sync(probe_memo &memo, const puzzle &p);
+    bool memo_stale(const probe_memo &memo, const probe_reach &reach);
+    void memo_probe(probe_memo &memo, probe_reach &reach, const puzzle::edge &e);
+    void memo_extend(probe_reach &reach, const puzzle &p, const puzzle &np);
 
-void puzzle_solver::go_without_line(puzzle &p,
-                                    const int &start_r, const int &start_c,
-                                    const int &src_p_r, const int &src_p_c,
-                                    const int &dst_p_r, const int &dst_p_c)
-{
-    if (p.point_can_up(dst_p_r, dst_p_c) &&
-        p.vrt[dst_p_r - 1][dst_p_c] == puzzle::NOT) // try draw up
-    {
-        draw_line(p,
-                  start_r, start_c,
-                  dst_p_r, dst_p_c,
-                  dst_p_r - 1, dst_p_c);
-    }
-    if (p.point_can_down(dst_p_r, dst_p_c) &&
-        p.vrt[dst_p_r][dst_p_c] == puzzle::NOT) // try draw down
-    {
-        draw_line(p,
-                  start_r, start_c,
-                  dst_p_r, dst_p_c,
-                  dst_p_r + 1, dst_p_c);
-    }
-    if (p.point_can_left(dst_p_r, dst_p_c) &&
-        p.hrz[dst_p_r][dst_p_c - 1] == puzzle::NOT) // try draw left
-    {
-        draw_line(p,
-                  start_r, start_c,
-                  dst_p_r, dst_p_c,
-                  dst_p_r, dst_p_c - 1);
-    }
-    if (p.point_can_right(dst_p_r, dst_p_c) &&
-        p.hrz[dst_p_r][dst_p_c] == puzzle::NOT) // try draw right
-    {
-        draw_line(p,
-                  start_r, start_c,
-                  dst_p_r, dst_p_c,
-                  dst_p_r, dst_p_c + 1);
-    }
-}
+    // Kinds of level one probes, and how often each decided something
+    enum probe_kind
+    {
+        PROBE_END, // the ways on from a line end
+        PROBE_HRZ,
+        PROBE_VRT,
+        PROBE_TWO, // the pairs of edges around a 2
+        PROBE_KINDS
+    };
+    struct probe_yield
+    {
+        size_t tries = 0; // heuristic runs spent
+        size_t hits = 0;  // candidates that decided an edge
+    };
+    array<probe_yield, PROBE_KINDS> yields;
 
-void puzzle_solver::draw_line(puzzle p,
-                              const int &start_r, const int &start_c,
-                              const int &src_p_r, const int &src_p_c,
-                              const int &dst_p_r, const int &dst_p_c)
-{
-    if (src_p_r == dst_p_r) // previous go horizontally
-    {
-        int h_r, h_c;
-        if (src_p_c > dst_p_c) // previous go left
-        {
-            h_r = dst_p_r;
-            h_c = dst_p_c;
-        }
-        else // previous go right
-        {
-            h_r = src_p_r;
-            h_c = src_p_c;
-        }
-        // Draw line
-        p.hrz[h_r][h_c] = puzzle::LINKED;
-        // Check lattice
-        if (!p.hrz_sat(h_r, h_c))
-            return;
-    }
-    else // previous go vertically
-    {
-        int v_r, v_c;
-        if (src_p_r > dst_p_r) // previous go up
-        {
-            v_r = dst_p_r;
-            v_c = dst_p_c;
-        }
-        else // previous go down
-        {
-            v_r = src_p_r;
-            v_c = src_p_c;
-        }
-        // Draw line
-        p.vrt[v_r][v_c] = puzzle::LINKED;
-        // Check lattice
-        if (!p.vrt_sat(v_r, v_c))
-            return;
-    }
-    // Check connectivity
-    if (p.get_conn(dst_p_r, dst_p_c) > 2 || p.get_conn(dst_p_r, dst_p_c) == 0)
-        return;
-    // Do heuristic
-    if (heuristic(p) == false)
-        return;
-    // If solved
-    if (dst_p_r == start_r && dst_p_c == start_c)
-    {
-        // Do final check
-        if (p.is_fin() && p.is_correct())
-        {
-            // Print solution
-            const auto result = p.to_string();
-            if (puzzle_results.find(result) == puzzle_results.end())
-            {
-                puzzle_results.insert(result);
-                cout << result;
-                *os << result;
-            }
-        }
-        return;
-    }
-    // Go next point
-    if (p.get_conn(dst_p_r, dst_p_c) == 2)
-    {
-        go_with_line(p, start_r, start_c, src_p_r, src_p_c, dst_p_r, dst_p_c);
-    }
-    else // 1
-    {
-        go_without_line(p, start_r, start_c, src_p_r, src_p_c, dst_p_r, dst_p_c);
-    }
-}
+    size_t commit_common(puzzle &p, const vector<const puzzle *> &alive);
+    bool try_draw(puzzle &p, size_t level, probe_memo &memo);
+    bool try_draw_deep(puzzle &p, size_t level);
+
+    void prepare();
+    void begin_deduction();
+    bool start();
+    void begin_search();
+    void restart();
+    bool step();
+    void write_checkpoint();
+    void end_root_start();
+    void go_with_line(puzzle p,
+                      const int &start_r, const int &start_c,
+                      int src_p_r, int src_p_c,
+                      int dst_p_r, int dst_p_c);
+    void go_without_line(puzzle p,
+                         const int &start_r, const int &start_c,
+                         const int &dst_p_r, const int &dst_p_c,
+                         bool root = false);
+    void draw_line(puzzle p,
+                   const int &start_r, const int &start_c,
+                   const int &src_p_r, const int &src_p_c,
+                   const int &dst_p_r, const int &dst_p_c);
+};
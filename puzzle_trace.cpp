@@ -0,0 +1,50 @@
+#include <sstream>
+
+#include "puzzle_trace.h"
+
+size_t solver_trace::tid()
+{
+    const auto id = this_thread::get_id();
+    const auto it = tids.find(id);
+    if (it != tids.end())
+        return it->second;
+    const size_t n = tids.size() + 1;
+    tids[id] = n;
+    return n;
+}
+
+void solver_trace::complete(const char *name, const char *cat, clock::time_point start,
+                            const string &args)
+{
+    const auto end = clock::now();
+    ostringstream ev;
+    lock_guard<mutex> guard(lock);
+    ev << "{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"X\""
+       << ",\"ts\":" << micros(start) << ",\"dur\":" << micros(end) - micros(start)
+       << ",\"pid\":1,\"tid\":" << tid();
+    if (!args.empty())
+        ev << ",\"args\":{" << args << "}";
+    ev << "}";
+    events.push_back(ev.str());
+}
+
+void solver_trace::counter(const char *name, const char *series, double value)
+{
+    const auto now = clock::now();
+    ostringstream ev;
+    lock_guard<mutex> guard(lock);
+    ev << "{\"name\":\"" << name << "\",\"ph\":\"C\",\"ts\":" << micros(now)
+       << ",\"pid\":1,\"args\":{\"" << series << "\":" << value << "}}";
+    events.push_back(ev.str());
+}
+
+void solver_trace::write(ostream &os)
+{
+    lock_guard<mutex> guard(lock);
+    os << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        os << events[i] << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    os << "]}\n";
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Chrome trace-event recorder, open the written file in chrome://tracing
+ * or ui.perfetto.dev
+ *
+ * {"traceEvents": [
+ *   {"name": "heuristic", "ph": "X", "ts": 12, "dur": 40, "pid": 1, "tid": 1, ...},
+ *   {"name": "edges decided", "ph": "C", "ts": 52, "pid": 1, "args": {"edges": 310}}
+ * ]}
+ *
+ * Times are microseconds since the recorder was made. Any thread may
+ * record; each gets its own track.
+ */
+class solver_trace
+{
+public:
+    using clock = chrono::steady_clock;
+
+    solver_trace() : origin(clock::now()) {}
+
+    // A span from start to now; args is a JSON object body or empty
+    void complete(const char *name, const char *cat, clock::time_point start,
+                  const string &args = "");
+    // A value on a counter track
+    void counter(const char *name, const char *series, double value);
+    void write(ostream &os);
+
+private:
+    clock::time_point origin;
+    mutex lock;
+    vector<string> events;
+    unordered_map<thread::id, size_t> tids;
+
+    long long micros(clock::time_point t)
+    {
+        return chrono::duration_cast<chrono::microseconds>(t - origin).count();
+    }
+    size_t tid();
+};
+
+// Records a span when it goes out of scope, nothing when trace is null
+class trace_span
+{
+public:
+    trace_span(solver_trace *trace, const char *name, const char *cat)
+        : trace(trace), name(name), cat(cat)
+    {
+        if (trace != nullptr)
+            start = solver_trace::clock::now();
+    }
+    ~trace_span()
+    {
+        if (trace != nullptr)
+            trace->complete(name, cat, start, args);
+    }
+    string args;
+
+private:
+    solver_trace *trace;
+    const char *name;
+    const char *cat;
+    solver_trace::clock::time_point start;
+};